@@ -0,0 +1,277 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#include "autotune.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include "pipeline.h"
+
+namespace {
+    double now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec*1e-9;
+    }
+
+    //a candidate has to beat the best so far by this much to be kept
+    const double improvement = 0.97;
+
+    //batches are kept to roughly the size of a large cache
+    const size_t maxBatchSamples = 1<<18;
+
+    std::string wisdomFile(const std::string& cacheFile)
+    {
+        return cacheFile+".wisdom";
+    }
+
+    const char* modeName(bool complex)
+    {
+        return complex ? "complex" : "real";
+    }
+}
+
+Autotuner::Result::Result() :
+    nsPerFrame(0),
+    cached(false)
+{
+}
+
+Autotuner::Autotuner(const std::string& cacheFile) :
+    cacheFile_(cacheFile)
+{
+}
+
+std::string Autotuner::hostKey()
+{
+    char host[256] = "";
+    gethostname(host, sizeof(host)-1);
+    std::string model = "unknown";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name")==0) {
+            size_t colon = line.find(':');
+            if (colon!=std::string::npos && colon+2<line.size())
+                model = line.substr(colon+2);
+            break;
+        }
+    }
+    std::ostringstream key;
+    key << host << "/" << model << "/" << boost::thread::hardware_concurrency();
+    //the key is one field of a space separated line
+    std::string result = key.str();
+    std::replace(result.begin(), result.end(), ' ', '_');
+    return result;
+}
+
+Autotuner::Result Autotuner::tune(size_t fftSize, bool complex, double budget)
+{
+    Result best;
+    if (!cacheFile_.empty()) {
+        FrameTransform::importWisdom(wisdomFile(cacheFile_));
+        if (load(fftSize, complex, best))
+            return best;
+    }
+
+    Budget time(budget, 6);
+    best.nsPerFrame = measure(fftSize, complex, best.settings, time.slice());
+    if (best.nsPerFrame<=0)
+        return Result();
+
+    TransformSettings candidate = best.settings;
+    candidate.rigor = FFTW_ESTIMATE;
+    tryCandidate(fftSize, complex, candidate, time, best);
+
+    for (size_t batch=4; batch*fftSize<=maxBatchSamples; batch*=4) {
+        candidate = best.settings;
+        candidate.batch = batch;
+        if (!tryCandidate(fftSize, complex, candidate, time, best))
+            break;
+    }
+
+    if (FrameTransform::threadsSupported()) {
+        unsigned cores = boost::thread::hardware_concurrency();
+        for (unsigned threads=2; threads<=cores; threads*=2) {
+            candidate = best.settings;
+            candidate.threads = threads;
+            if (!tryCandidate(fftSize, complex, candidate, time, best))
+                break;
+        }
+    }
+
+    //patient planning can take far longer than the rest put together, so
+    //fftw is held to what is left of the budget.  The limit is only for the
+    //search - the processing threads find the plan in the plan cache or the
+    //wisdom
+    candidate = best.settings;
+    candidate.rigor = FFTW_PATIENT;
+    candidate.planTimeLimit = std::max(time.left()/2, 0.0);
+    tryCandidate(fftSize, complex, candidate, time, best);
+    best.settings.planTimeLimit = -1;
+
+    if (!cacheFile_.empty()) {
+        save(fftSize, complex, best);
+        FrameTransform::exportWisdom(wisdomFile(cacheFile_));
+    }
+    return best;
+}
+
+Autotuner::Budget::Budget(double seconds, size_t candidates) :
+    deadline_(now()+seconds),
+    candidates_(candidates)
+{
+}
+
+double Autotuner::Budget::left() const
+{
+    return deadline_-now();
+}
+
+double Autotuner::Budget::slice()
+{
+    //an even share of what is left, but no more than is needed for a
+    //steady figure
+    double share = left()/std::max(candidates_, size_t(1));
+    if (candidates_>1)
+        candidates_--;
+    return std::min(0.1, share);
+}
+
+bool Autotuner::tryCandidate(size_t fftSize, bool complex, const TransformSettings& candidate, Budget& time, Result& best)
+{
+    if (time.left()<=0)
+        return false;
+    double ns = measure(fftSize, complex, candidate, time.slice());
+    if (!(ns>0 && ns<best.nsPerFrame*improvement))
+        return false;
+    best.settings = candidate;
+    best.nsPerFrame = ns;
+    return true;
+}
+
+double Autotuner::measure(size_t fftSize, bool complex, const TransformSettings& settings, double seconds)
+{
+    //nanoseconds per frame for the fft and db psd of real or complex input
+    PsdPipeline pipeline(fftSize, 1);
+    pipeline.setTransform(settings, settings);
+    size_t batch = settings.batch;
+    std::vector<float> data((complex ? 2 : 1)*fftSize*batch);
+    for (size_t i=0; i<data.size(); i++)
+        data[i] = rand()/float(RAND_MAX)-0.5f;
+
+    //the first pass makes the plans and warms the caches
+    float* psd;
+    size_t psdLen;
+    pipeline.run(&data[0], fftSize*batch, complex, NULL, batch);
+    for (size_t frame=0; frame<batch; frame++) {
+        pipeline.selectFrame(frame);
+        pipeline.psd(10, psd, psdLen, false);
+    }
+    pipeline.done();
+    if (seconds<=0)
+        return 0;
+
+    size_t frames = 0;
+    double start = now();
+    double elapsed = 0;
+    while (elapsed<seconds || frames<8) {
+        pipeline.run(&data[0], fftSize*batch, complex, NULL, batch);
+        for (size_t frame=0; frame<batch; frame++) {
+            pipeline.selectFrame(frame);
+            pipeline.psd(10, psd, psdLen, false);
+        }
+        pipeline.done();
+        frames += batch;
+        elapsed = now()-start;
+    }
+    return elapsed*1e9/frames;
+}
+
+bool Autotuner::load(size_t fftSize, bool complex, Result& result)
+{
+    std::ifstream file(cacheFile_.c_str());
+    std::string host = hostKey();
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string lineHost, mode, rigor;
+        size_t size;
+        Result entry;
+        if (!(fields >> lineHost >> size >> mode >> rigor >> entry.settings.threads >> entry.settings.batch >> entry.nsPerFrame))
+            continue;
+        if (lineHost!=host || size!=fftSize || mode!=modeName(complex) ||
+            !TransformSettings::parseRigor(rigor, entry.settings.rigor))
+            continue;
+        if (entry.settings.threads>1 && !FrameTransform::threadsSupported())
+            continue;
+        entry.settings.threads = std::max(entry.settings.threads, 1u);
+        entry.settings.batch = std::max(entry.settings.batch, size_t(1));
+        entry.cached = true;
+        result = entry;
+        return true;
+    }
+    return false;
+}
+
+void Autotuner::save(size_t fftSize, bool complex, const Result& result)
+{
+    //every other line is kept as it was - written to a file of our own and
+    //renamed, so neither a reader nor another instance saving at the same
+    //time ever sees a partial file
+    std::string host = hostKey();
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(cacheFile_.c_str());
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            std::string lineHost, mode;
+            size_t size;
+            //lines from before the mode was recorded are dropped with it
+            if ((fields >> lineHost >> size >> mode) && lineHost==host && size==fftSize &&
+                (mode==modeName(complex) || (mode!=modeName(false) && mode!=modeName(true))))
+                continue;
+            lines.push_back(line);
+        }
+    }
+    std::ostringstream entry;
+    entry << host << " " << fftSize << " " << modeName(complex) << " "
+          << TransformSettings::rigorName(result.settings.rigor) << " "
+          << result.settings.threads << " " << result.settings.batch << " " << result.nsPerFrame;
+    lines.push_back(entry.str());
+
+    std::string temp;
+    FILE* file = FrameTransform::createTemp(cacheFile_, temp);
+    if (!file)
+        return;
+    for (size_t i=0; i<lines.size(); i++)
+        fprintf(file, "%s\n", lines[i].c_str());
+    bool written = !ferror(file);
+    if (fclose(file)!=0 || !written || rename(temp.c_str(), cacheFile_.c_str())!=0)
+        unlink(temp.c_str());
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#ifndef PSD_AUTOTUNE_H
+#define PSD_AUTOTUNE_H
+
+#include <string>
+#include "transform.h"
+
+class Autotuner
+{
+    //picks the TransformSettings that run a given fft size fastest on this host
+    //
+    //candidates are timed running the transform and psd of the processing
+    //path on synthetic frames of the mode being tuned (real and complex input
+    //plan differently), one setting at a time starting from the
+    //defaults: estimate planning, then batching, then fftw threads, then
+    //patient planning.  A change is only kept if it is clearly (3%) faster,
+    //and the search stops when the time budget runs out - planning time
+    //counts against it.
+    //
+    //choices are cached in a text file, one line per host, fft size and mode
+    //
+    //    <host> <fftSize> <real|complex> <rigor> <threads> <batch> <ns per frame>
+    //
+    //where host is the host name, cpu model and cpu count, and the fftw
+    //wisdom goes in the same file name with ".wisdom" on the end, so a cached
+    //choice plans as quickly as the defaults.  Hosts sharing the file (over
+    //nfs, say) each keep their own lines, and both files are replaced by
+    //renaming a file of our own over them, so instances updating them at the
+    //same time can lose each other's update but never corrupt the file.
+public:
+    struct Result {
+        Result();
+
+        TransformSettings settings;
+        //measured time per frame - 0 for the untested defaults
+        double nsPerFrame;
+        //read from the cache rather than measured
+        bool cached;
+    };
+
+    explicit Autotuner(const std::string& cacheFile);
+
+    //the cached choice for fftSize and mode, or the fastest found within
+    //budget seconds
+    Result tune(size_t fftSize, bool complex, double budget);
+
+    //identifies this host in the cache
+    static std::string hostKey();
+
+private:
+    class Budget {
+    public:
+        //seconds shared between about this many candidates
+        Budget(double seconds, size_t candidates);
+        double left() const;
+        //time to spend measuring the next candidate
+        double slice();
+    private:
+        double deadline_;
+        size_t candidates_;
+    };
+
+    //keep candidate in best if it is clearly faster - false if it is not, or
+    //the budget has run out
+    bool tryCandidate(size_t fftSize, bool complex, const TransformSettings& candidate, Budget& time, Result& best);
+    double measure(size_t fftSize, bool complex, const TransformSettings& settings, double seconds);
+    bool load(size_t fftSize, bool complex, Result& result);
+    void save(size_t fftSize, bool complex, const Result& result);
+
+    std::string cacheFile_;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+PsdConfig::PsdConfig() :
+    fftSz(0),
+    strideSize(0),
+    overlap(0),
+    numAverage(0),
+    doFFT(false),
+    doPSD(false),
+    doWaterfall(false),
+    rfFreqUnits(false),
+    logCoeff(0),
+    psdWidth(0),
+    pooling(PsdPipeline::POOL_MEAN),
+    shmExport(false),
+    shmDepth(0),
+    idleTimeout(0),
+    realtimePriority(0),
+    waterfallConnects(0),
+    version(0),
+    fftSzVersion(0),
+    transformVersion(0),
+    crossVersion(0),
+    numAverageVersion(0),
+    poolingVersion(0),
+    waterfallVersion(0),
+    sriVersion(0),
+    shmVersion(0),
+    placementVersion(0)
+{
+}
+
+ConfigPublisher::ConfigPublisher() :
+    current_(new PsdConfig())
+{
+}
+
+ConfigPublisher::~ConfigPublisher()
+{
+    //every reader is gone by now
+    for (size_t i=0; i<retired_.size(); i++)
+        delete retired_[i];
+    delete current_;
+}
+
+void ConfigPublisher::publish(const PsdConfig& config)
+{
+    boost::mutex::scoped_lock lock(lock_);
+    PsdConfig* last = current_;
+    PsdConfig* next = new PsdConfig(config);
+    unsigned long version = last->version+1;
+    next->version = version;
+
+    bool fftSz = next->fftSz!=last->fftSz;
+    next->fftSzVersion = fftSz ? version : last->fftSzVersion;
+
+    bool transform = next->transform[0]!=last->transform[0] || next->transform[1]!=last->transform[1];
+    next->transformVersion = transform ? version : last->transformVersion;
+
+    bool cross = next->crossStreams!=last->crossStreams;
+    next->crossVersion = cross ? version : last->crossVersion;
+
+    bool numAverage = next->numAverage!=last->numAverage;
+    next->numAverageVersion = numAverage ? version : last->numAverageVersion;
+
+    bool pooling = next->psdWidth!=last->psdWidth || next->pooling!=last->pooling;
+    next->poolingVersion = pooling ? version : last->poolingVersion;
+
+    bool waterfall = next->waterfall!=last->waterfall || next->logCoeff!=last->logCoeff;
+    next->waterfallVersion = waterfall ? version : last->waterfallVersion;
+
+    bool shm = next->shmExport!=last->shmExport ||
+            (next->shmExport && (next->shmPrefix!=last->shmPrefix || next->shmDepth!=last->shmDepth));
+    next->shmVersion = shm ? version : last->shmVersion;
+
+    bool placement = next->cpuAffinity!=last->cpuAffinity || next->realtimePriority!=last->realtimePriority;
+    next->placementVersion = placement ? version : last->placementVersion;
+
+    // outputs that were not being fed may have missed sri changes, so the
+    // actions count too
+    bool sri = fftSz || numAverage || pooling || shm ||
+            next->overlap!=last->overlap ||
+            next->rfFreqUnits!=last->rfFreqUnits ||
+            next->doFFT!=last->doFFT ||
+            next->doPSD!=last->doPSD ||
+            next->doWaterfall!=last->doWaterfall ||
+            next->waterfallConnects!=last->waterfallConnects;
+    next->sriVersion = sri ? version : last->sriVersion;
+
+    //the snapshot is complete before any reader can see it
+    __sync_synchronize();
+    retired_.push_back(last);
+    current_ = next;
+    reclaimLocked();
+}
+
+void ConfigPublisher::reclaim()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    reclaimLocked();
+}
+
+size_t ConfigPublisher::retained()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    return retired_.size();
+}
+
+void ConfigPublisher::reclaimLocked()
+{
+    //a reader only ever moves to newer snapshots, so nothing older than the
+    //oldest version still in use can be reached again
+    unsigned long oldest = current_->version;
+    for (std::set<ConfigReader*>::iterator i=readers_.begin(); i!=readers_.end(); i++)
+        oldest = std::min(oldest, static_cast<unsigned long>((*i)->seen_));
+    std::vector<PsdConfig*> keep;
+    for (size_t i=0; i<retired_.size(); i++) {
+        if (retired_[i]->version < oldest)
+            delete retired_[i];
+        else
+            keep.push_back(retired_[i]);
+    }
+    retired_.swap(keep);
+}
+
+ConfigReader::ConfigReader(ConfigPublisher& publisher) :
+    publisher_(publisher)
+{
+    boost::mutex::scoped_lock lock(publisher_.lock_);
+    config_ = publisher_.current_;
+    seen_ = config_->version;
+    publisher_.readers_.insert(this);
+}
+
+ConfigReader::~ConfigReader()
+{
+    boost::mutex::scoped_lock lock(publisher_.lock_);
+    publisher_.readers_.erase(this);
+}
@@ -0,0 +1,149 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_CONFIG_H
+#define PSD_CONFIG_H
+
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include "pipeline.h"
+#include "placement.h"
+#include "waterfallcodec.h"
+
+struct PsdConfig
+{
+    //processing settings shared by every stream
+    //
+    //a published snapshot is never modified.  Besides its own version each
+    //snapshot carries the version that last changed each group of settings,
+    //so a processor that last applied version v redoes exactly the groups
+    //stamped later than v
+    PsdConfig();
+
+    size_t fftSz;
+    size_t strideSize;
+    int overlap;
+    size_t numAverage;
+    bool doFFT;
+    bool doPSD;
+    bool doWaterfall;
+    bool rfFreqUnits;
+    float logCoeff;
+    size_t psdWidth;
+    PsdPipeline::Pooling pooling;
+    WaterfallEncoder::Settings waterfall;
+    // [0] for real input, [1] for complex
+    TransformSettings transform[2];
+    //streams whose fft frames go to the cross spectra - they always keep
+    //their fft
+    std::set<std::string> crossStreams;
+    bool shmExport;
+    std::string shmPrefix;
+    size_t shmDepth;
+    float idleTimeout;
+    std::string cpuAffinity;
+    int realtimePriority;
+    ThreadPlacement placement;
+    //counts connections made while the waterfall output is connected - a
+    //change resends the sri, which starts the waterfall on a keyframe
+    unsigned long waterfallConnects;
+
+    //filled in by ConfigPublisher::publish
+    unsigned long version;
+    unsigned long fftSzVersion;
+    unsigned long transformVersion;
+    unsigned long crossVersion;
+    unsigned long numAverageVersion;
+    unsigned long poolingVersion;
+    unsigned long waterfallVersion;
+    unsigned long sriVersion;
+    unsigned long shmVersion;
+    unsigned long placementVersion;
+};
+
+class ConfigReader;
+
+class ConfigPublisher
+{
+    //hands PsdConfig snapshots to the processing threads without locking them
+    //
+    //publishing swaps a single pointer, and a reader picks up the latest
+    //snapshot with one load of it per frame.  Replaced snapshots are kept
+    //until every registered reader has moved on to a newer version.
+    //
+    //only publishing, reclaiming and reader registration take the lock
+public:
+    ConfigPublisher();
+    ~ConfigPublisher();
+
+    //publish a copy of config - the versions are filled in by comparing it
+    //with the current snapshot
+    void publish(const PsdConfig& config);
+
+    //free the replaced snapshots no reader can still be using
+    void reclaim();
+
+    //snapshots waiting for readers to move on
+    size_t retained();
+
+private:
+    friend class ConfigReader;
+
+    void reclaimLocked();
+
+    PsdConfig* volatile current_;
+    std::vector<PsdConfig*> retired_;
+    std::set<ConfigReader*> readers_;
+    boost::mutex lock_;
+};
+
+class ConfigReader
+{
+    //one processing thread's view of the published configuration
+public:
+    explicit ConfigReader(ConfigPublisher& publisher);
+    ~ConfigReader();
+
+    //latest published snapshot - references to the previous one must not be
+    //used after this is called
+    const PsdConfig& update()
+    {
+        PsdConfig* latest = publisher_.current_;
+        if (latest != config_) {
+            //every read of the old snapshot is done before it can be freed
+            __sync_synchronize();
+            config_ = latest;
+            seen_ = latest->version;
+        }
+        return *config_;
+    }
+
+    //the snapshot returned by the last update()
+    const PsdConfig& current() const {return *config_;}
+
+private:
+    friend class ConfigPublisher;
+
+    ConfigPublisher& publisher_;
+    const PsdConfig* config_;
+    volatile unsigned long seen_;
+};
+
+#endif
@@ -0,0 +1,295 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#include "crossspectra.h"
+
+#include <algorithm>
+#include <ossie/PropertyMap.h>
+#include "framepool.h"
+
+CrossSpectra::PairState::PairState(const Pair& pair, size_t numAvg) :
+    pair(pair),
+    active(true),
+    numAvg(numAvg),
+    count(0)
+{
+}
+
+CrossSpectra::CrossSpectra(bulkio::OutFloatPort* port) :
+    port_(port),
+    running_(false),
+    sender_(NULL)
+{
+}
+
+CrossSpectra::~CrossSpectra()
+{
+    for (std::map<Pair, StatePtr>::iterator i=pairs_.begin(); i!=pairs_.end(); i++) {
+        boost::mutex::scoped_lock stateLock(i->second->lock);
+        close(i->second);
+    }
+    //the sender finishes what is queued before it exits
+    {
+        boost::mutex::scoped_lock lock(queueLock_);
+        if (!sender_)
+            return;
+        running_ = false;
+        notEmpty_.notify_all();
+    }
+    sender_->join();
+    delete sender_;
+}
+
+void CrossSpectra::configure(const std::vector<Pair>& pairs, size_t numAvg)
+{
+    numAvg = std::max(numAvg, size_t(1));
+    boost::mutex::scoped_lock lock(lock_);
+    std::map<Pair, StatePtr> kept;
+    std::map<std::string, std::vector<StatePtr> > streams;
+    for (size_t i=0; i<pairs.size(); i++) {
+        if (kept.count(pairs[i]))
+            continue;
+        StatePtr state;
+        std::map<Pair, StatePtr>::iterator existing = pairs_.find(pairs[i]);
+        if (existing!=pairs_.end()) {
+            state = existing->second;
+            pairs_.erase(existing);
+            boost::mutex::scoped_lock stateLock(state->lock);
+            if (state->numAvg!=numAvg) {
+                state->numAvg = numAvg;
+                state->count = 0;
+            }
+        } else {
+            state.reset(new PairState(pairs[i], numAvg));
+        }
+        kept[pairs[i]] = state;
+        streams[pairs[i].a].push_back(state);
+        streams[pairs[i].b].push_back(state);
+    }
+    //what is left was dropped - a thread still holding one sees it is no
+    //longer active
+    for (std::map<Pair, StatePtr>::iterator i=pairs_.begin(); i!=pairs_.end(); i++) {
+        boost::mutex::scoped_lock stateLock(i->second->lock);
+        close(i->second);
+    }
+    pairs_.swap(kept);
+    streams_.swap(streams);
+}
+
+std::set<std::string> CrossSpectra::streams()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    std::set<std::string> streams;
+    for (std::map<std::string, std::vector<StatePtr> >::iterator i=streams_.begin(); i!=streams_.end(); i++)
+        streams.insert(i->first);
+    return streams;
+}
+
+void CrossSpectra::push(const std::string& streamID, const redhawk::shared_buffer<std::complex<float> >& fft,
+                        const BULKIO::PrecisionUTCTime& time, const SRIPtr& sri, double sampleTime)
+{
+    std::vector<StatePtr> states;
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        std::map<std::string, std::vector<StatePtr> >::iterator found = streams_.find(streamID);
+        if (found==streams_.end())
+            return;
+        states = found->second;
+    }
+    Frame frame;
+    frame.fft = fft;
+    frame.time = time;
+    frame.sri = sri;
+    for (size_t i=0; i<states.size(); i++) {
+        boost::mutex::scoped_lock lock(states[i]->lock);
+        if (!states[i]->active)
+            continue;
+        if (states[i]->pair.a==streamID)
+            match(states[i], 0, frame, sampleTime/2);
+        if (states[i]->pair.b==streamID)
+            match(states[i], 1, frame, sampleTime/2);
+    }
+}
+
+void CrossSpectra::match(const StatePtr& state, size_t side, const Frame& frame, double tolerance)
+{
+    //each stream's frames arrive in time order, so a waiting frame of the
+    //other stream that is older than this one can never be matched
+    std::deque<Frame>& others = state->pending[1-side];
+    while (!others.empty() && others.front().time-frame.time < -tolerance)
+        others.pop_front();
+    if (others.empty() || others.front().time-frame.time > tolerance) {
+        std::deque<Frame>& waiting = state->pending[side];
+        waiting.push_back(frame);
+        if (waiting.size()>maxPending)
+            waiting.pop_front();
+        return;
+    }
+    Frame other = others.front();
+    others.pop_front();
+    if (side==0)
+        accumulate(state, frame, other);
+    else
+        accumulate(state, other, frame);
+}
+
+void CrossSpectra::accumulate(const StatePtr& statePtr, const Frame& a, const Frame& b)
+{
+    PairState& state = *statePtr;
+    size_t bins = a.fft.size();
+    if (b.fft.size()!=bins) {
+        state.count = 0;
+        return;
+    }
+    if (state.count==0 || state.sab.size()!=bins) {
+        state.sab.assign(bins, std::complex<float>(0, 0));
+        state.saa.assign(bins, 0.0f);
+        state.sbb.assign(bins, 0.0f);
+        state.count = 0;
+    }
+    //written out rather than with std::complex operators, which check for
+    //infinities on every multiply
+    const std::complex<float>* x = a.fft.data();
+    const std::complex<float>* y = b.fft.data();
+    for (size_t i=0; i<bins; i++) {
+        float xr = x[i].real(), xi = x[i].imag();
+        float yr = y[i].real(), yi = y[i].imag();
+        state.sab[i] += std::complex<float>(xr*yr + xi*yi, xi*yr - xr*yi);
+        state.saa[i] += xr*xr + xi*xi;
+        state.sbb[i] += yr*yr + yi*yi;
+    }
+    if (++state.count < state.numAvg)
+        return;
+    write(statePtr, a);
+    state.count = 0;
+}
+
+void CrossSpectra::write(const StatePtr& statePtr, const Frame& a)
+{
+    //copy the average out for the sender - the sums carry on under the lock
+    PairState& state = *statePtr;
+    size_t bins = state.sab.size();
+    redhawk::buffer<float> csd = FramePool::instance().lease<float>(2*bins);
+    redhawk::buffer<float> coherence = FramePool::instance().lease<float>(bins);
+    float scale = 1.0f/state.count;
+    for (size_t i=0; i<bins; i++) {
+        float re = state.sab[i].real(), im = state.sab[i].imag();
+        csd[2*i] = re*scale;
+        csd[2*i+1] = im*scale;
+        float power = state.saa[i]*state.sbb[i];
+        coherence[i] = power>0 ? (re*re + im*im)/power : 0.0f;
+    }
+
+    Output output;
+    output.state = statePtr;
+    output.close = false;
+    output.sri = *a.sri;
+    output.sri.ydelta *= state.count;
+    redhawk::PropertyMap& keywords = redhawk::PropertyMap::cast(output.sri.keywords);
+    keywords["CSD_STREAM_A"] = state.pair.a;
+    keywords["CSD_STREAM_B"] = state.pair.b;
+    output.csd = csd;
+    output.coherence = coherence;
+    output.time = a.time;
+    enqueue(output);
+}
+
+void CrossSpectra::close(const StatePtr& state)
+{
+    //the streams are closed by the sender, after anything already queued
+    state->active = false;
+    state->pending[0].clear();
+    state->pending[1].clear();
+    state->count = 0;
+    Output output;
+    output.state = state;
+    output.close = true;
+    enqueue(output);
+}
+
+void CrossSpectra::enqueue(const Output& output)
+{
+    boost::mutex::scoped_lock lock(queueLock_);
+    if (!sender_) {
+        running_ = true;
+        sender_ = new boost::thread(&CrossSpectra::run, this);
+    }
+    if (queue_.size()>=maxQueued) {
+        //drop the oldest average - closes are never dropped
+        for (std::deque<Output>::iterator i=queue_.begin(); i!=queue_.end(); ++i) {
+            if (!i->close) {
+                queue_.erase(i);
+                break;
+            }
+        }
+    }
+    queue_.push_back(output);
+    notEmpty_.notify_one();
+}
+
+void CrossSpectra::run()
+{
+    boost::mutex::scoped_lock lock(queueLock_);
+    while (true) {
+        //sent frames go back for the processing threads to reuse once
+        //nothing has come for a while
+        if (running_ && queue_.empty() && !notEmpty_.timed_wait(lock, boost::posix_time::milliseconds(100)))
+            FramePool::instance().releaseThread();
+        while (running_ && queue_.empty())
+            notEmpty_.wait(lock);
+        if (queue_.empty())
+            break;
+        Output output = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+        send(output);
+        lock.lock();
+    }
+}
+
+void CrossSpectra::send(Output& output)
+{
+    PairState& state = *output.state;
+    if (output.close) {
+        if (!!state.csd)
+            state.csd.close();
+        if (!!state.coherence)
+            state.coherence.close();
+        state.csd = bulkio::OutFloatStream();
+        state.coherence = bulkio::OutFloatStream();
+        return;
+    }
+
+    BULKIO::StreamSRI& sri = output.sri;
+    sri.streamID = "csd:"+state.pair.a+":"+state.pair.b;
+    sri.mode = 1;
+    if (!state.csd)
+        state.csd = port_->createStream(sri);
+    else
+        state.csd.sri(sri);
+    state.csd.write(output.csd, output.time);
+
+    sri.streamID = "coherence:"+state.pair.a+":"+state.pair.b;
+    sri.mode = 0;
+    if (!state.coherence)
+        state.coherence = port_->createStream(sri);
+    else
+        state.coherence.sri(sri);
+    state.coherence.write(output.coherence, output.time);
+}
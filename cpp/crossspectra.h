@@ -0,0 +1,152 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#ifndef PSD_CROSSSPECTRA_H
+#define PSD_CROSSSPECTRA_H
+
+#include <complex>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <bulkio/bulkio.h>
+
+class CrossSpectra
+{
+    //averaged cross spectral density and coherence of configured stream pairs
+    //
+    //each paired stream's processing thread hands over the fft frames it has
+    //already computed (in fft output order) and the frames of a pair are
+    //matched up by timestamp.  Whichever thread completes a match adds it into
+    //the pair's sums, so the work is spread over the streams' own threads and
+    //only the two threads of a pair ever wait on each other.
+    //
+    //every numAvg matched frames a pair writes two streams to the port
+    //
+    //    csd:<a>:<b>        mean of A conj(B) - complex, one value per fft bin
+    //    coherence:<a>:<b>  |Sab|^2/(Saa Sbb) - real, 0 to 1
+    //
+    //with the sri of stream a's fft output.  The averages are copied out under
+    //the pair's lock and queued for a sender thread, which makes all of the
+    //bulkio calls, so a slow consumer never holds up a processing thread.  If
+    //the sender falls maxQueued averages behind the oldest queued average is
+    //dropped.
+    //
+    //a frame waits for its partner for up to maxPending frames of the other
+    //stream, so the streams can run a little apart.  Frames that are never
+    //matched (a gap in one stream, or timestamps that do not line up within
+    //half a sample) are dropped, as are frames of different sizes.
+public:
+    struct Pair {
+        Pair(const std::string& a, const std::string& b) : a(a), b(b) {}
+        bool operator<(const Pair& other) const {return a<other.a || (a==other.a && b<other.b);}
+
+        std::string a;
+        std::string b;
+    };
+
+    typedef boost::shared_ptr<const BULKIO::StreamSRI> SRIPtr;
+
+    static const size_t maxPending = 32;
+    static const size_t maxQueued = 64;
+
+    explicit CrossSpectra(bulkio::OutFloatPort* port);
+    ~CrossSpectra();
+
+    //pairs kept from the last call carry on averaging, unless numAvg changed.
+    //The output streams of dropped pairs are closed once their queued
+    //averages have been sent
+    void configure(const std::vector<Pair>& pairs, size_t numAvg);
+
+    //every stream in a pair
+    std::set<std::string> streams();
+
+    //one fft frame of a stream, with the sri of its fft output and the
+    //sample period of its input.  The frame must not be modified after this
+    void push(const std::string& streamID, const redhawk::shared_buffer<std::complex<float> >& fft,
+              const BULKIO::PrecisionUTCTime& time, const SRIPtr& sri, double sampleTime);
+
+private:
+    struct Frame {
+        redhawk::shared_buffer<std::complex<float> > fft;
+        BULKIO::PrecisionUTCTime time;
+        SRIPtr sri;
+    };
+
+    struct PairState {
+        PairState(const Pair& pair, size_t numAvg);
+
+        Pair pair;
+        boost::mutex lock;
+        //cleared when the pair is dropped
+        bool active;
+        //frames waiting for a partner - [0] for a, [1] for b
+        std::deque<Frame> pending[2];
+        size_t numAvg;
+        size_t count;
+        std::vector<std::complex<float> > sab;
+        std::vector<float> saa;
+        std::vector<float> sbb;
+        //only touched by the sender thread
+        bulkio::OutFloatStream csd;
+        bulkio::OutFloatStream coherence;
+    };
+    typedef boost::shared_ptr<PairState> StatePtr;
+
+    //one average for the sender, or the end of a pair's streams
+    struct Output {
+        StatePtr state;
+        bool close;
+        BULKIO::StreamSRI sri;
+        redhawk::shared_buffer<float> csd;
+        redhawk::shared_buffer<float> coherence;
+        BULKIO::PrecisionUTCTime time;
+    };
+
+    //called with the pair's lock held
+    void match(const StatePtr& state, size_t side, const Frame& frame, double tolerance);
+    void accumulate(const StatePtr& state, const Frame& a, const Frame& b);
+    void write(const StatePtr& state, const Frame& a);
+    void close(const StatePtr& state);
+
+    void enqueue(const Output& output);
+    void run();
+    void send(Output& output);
+
+    bulkio::OutFloatPort* port_;
+
+    boost::mutex lock_;
+    std::map<Pair, StatePtr> pairs_;
+    //the pairs each stream is in
+    std::map<std::string, std::vector<StatePtr> > streams_;
+
+    //sender - started by the first queued output
+    boost::mutex queueLock_;
+    boost::condition_variable notEmpty_;
+    std::deque<Output> queue_;
+    bool running_;
+    boost::thread* sender_;
+};
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#include "framepool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <boost/thread/thread.hpp>
+#include <fftw3.h>
+#include "placement.h"
+
+FramePool& FramePool::instance()
+{
+    static FramePool pool;
+    return pool;
+}
+
+const size_t FramePool::threadBatch;
+
+FramePool::FramePool() :
+    minFree_(std::max(1u, boost::thread::hardware_concurrency())),
+    bytes_(0),
+    leased_(0),
+    allocated_(0),
+    lockMemory_(false),
+    lockFailures_(0),
+    cache_(&FramePool::threadExit)
+{
+}
+
+FramePool::~FramePool()
+{
+    //leased buffers are returned to a destroyed pool only at process exit
+    releaseThread();
+    for (std::map<size_t, SizeClass>::iterator size=sizes_.begin(); size!=sizes_.end(); ++size) {
+        for (size_t i=0; i<size->second.free.size(); i++)
+            free(size->second.free[i], size->first, lockMemory_);
+    }
+}
+
+FramePool::ThreadCache& FramePool::threadCache()
+{
+    ThreadCache* cache = cache_.get();
+    if (!cache) {
+        cache = new ThreadCache();
+        cache_.reset(cache);
+    }
+    return *cache;
+}
+
+void* FramePool::acquire(size_t bytes, bool& paged)
+{
+    __sync_fetch_and_add(&leased_, 1);
+    BufferList& own = threadCache()[bytes];
+    bool lockMemory = lockMemory_;
+    //most recently released first - it is the most likely to be in cache.
+    //Buffers from before lockMemory changed are not used
+    BufferList stale;
+    while (!own.empty() && own.back().paged!=lockMemory) {
+        stale.push_back(own.back());
+        own.pop_back();
+    }
+    if (!stale.empty())
+        giveBack(bytes, stale);
+    if (!own.empty()) {
+        paged = own.back().paged;
+        void* data = own.back().data;
+        own.pop_back();
+        return data;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        SizeClass& size = sizes_[bytes];
+        lockMemory = lockMemory_;
+        paged = lockMemory;
+        if (!size.free.empty()) {
+            //take a batch, so the next few leases need no lock - the most
+            //recently released is leased now and the next is kept on top
+            size_t count = std::min(size.free.size(), threadBatch);
+            std::vector<void*>::iterator first = size.free.end()-count;
+            for (std::vector<void*>::iterator i=first; i!=size.free.end()-1; ++i)
+                own.push_back(Buffer(*i, lockMemory));
+            void* data = size.free.back();
+            size.free.erase(first, size.free.end());
+            size.leased += count;
+            return data;
+        }
+        size.leased++;
+        bytes_ += lockMemory ? ThreadPlacement::roundPages(bytes) : bytes;
+        allocated_++;
+    }
+    size_t allocBytes = std::max(bytes, size_t(1));
+    void* data;
+    if (lockMemory) {
+        allocBytes = ThreadPlacement::roundPages(allocBytes);
+        data = ThreadPlacement::allocatePages(allocBytes);
+    } else {
+        data = fftwf_malloc(allocBytes);
+        if (!data)
+            throw std::bad_alloc();
+    }
+    //first touch from the leasing thread puts the pages on its node
+    memset(data, 0, allocBytes);
+    if (lockMemory && !ThreadPlacement::lockPages(data, allocBytes)) {
+        boost::mutex::scoped_lock lock(lock_);
+        lockFailures_++;
+    }
+    return data;
+}
+
+void FramePool::release(void* data, size_t bytes, bool paged)
+{
+    //usually run on a sender thread, which only ever releases - past a
+    //batch the oldest go back to the shared list for the leasing threads
+    __sync_fetch_and_sub(&leased_, 1);
+    BufferList& own = threadCache()[bytes];
+    own.push_back(Buffer(data, paged));
+    if (own.size() > threadBatch) {
+        BufferList spill(own.begin(), own.begin()+threadBatch);
+        own.erase(own.begin(), own.begin()+threadBatch);
+        giveBack(bytes, spill);
+    }
+}
+
+void FramePool::releaseThread()
+{
+    ThreadCache* cache = cache_.get();
+    if (!cache)
+        return;
+    for (ThreadCache::iterator own=cache->begin(); own!=cache->end(); ++own) {
+        if (!own->second.empty())
+            giveBack(own->first, own->second);
+    }
+    cache->clear();
+}
+
+void FramePool::threadExit(ThreadCache* cache)
+{
+    for (ThreadCache::iterator own=cache->begin(); own!=cache->end(); ++own) {
+        if (!own->second.empty())
+            instance().giveBack(own->first, own->second);
+    }
+    delete cache;
+}
+
+void FramePool::giveBack(size_t bytes, const BufferList& buffers)
+{
+    BufferList unused;
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        SizeClass& size = sizes_[bytes];
+        for (size_t i=0; i<buffers.size(); i++) {
+            size.leased--;
+            //a buffer from before lockMemory changed is not kept.  Room for
+            //a whole batch on top, as they come and go that way
+            if (buffers[i].paged==lockMemory_ && size.free.size() < std::max(minFree_, size.leased)+threadBatch) {
+                size.free.push_back(buffers[i].data);
+            } else {
+                unused.push_back(buffers[i]);
+                bytes_ -= buffers[i].paged ? ThreadPlacement::roundPages(bytes) : bytes;
+            }
+        }
+    }
+    for (size_t i=0; i<unused.size(); i++)
+        free(unused[i].data, bytes, unused[i].paged);
+}
+
+void FramePool::free(void* data, size_t bytes, bool paged)
+{
+    if (paged) {
+        ThreadPlacement::unlockPages(data, ThreadPlacement::roundPages(bytes));
+        ::free(data);
+    } else {
+        fftwf_free(data);
+    }
+}
+
+void FramePool::trim()
+{
+    std::vector<std::pair<void*, size_t> > unused;
+    bool paged;
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        //the shared lists only hold the current kind
+        paged = lockMemory_;
+        std::map<size_t, SizeClass>::iterator size = sizes_.begin();
+        while (size!=sizes_.end()) {
+            if (size->second.leased==0) {
+                for (size_t i=0; i<size->second.free.size(); i++) {
+                    unused.push_back(std::make_pair(size->second.free[i], size->first));
+                    bytes_ -= paged ? ThreadPlacement::roundPages(size->first) : size->first;
+                }
+                sizes_.erase(size++);
+            } else {
+                ++size;
+            }
+        }
+    }
+    for (size_t i=0; i<unused.size(); i++)
+        free(unused[i].first, unused[i].second, paged);
+}
+
+void FramePool::setLockMemory(bool lock)
+{
+    //free buffers of the old kind are dropped now, leased ones when they come
+    //back and those kept by a thread when it reaches them
+    std::vector<std::pair<void*, size_t> > unused;
+    {
+        boost::mutex::scoped_lock guard(lock_);
+        if (lock==lockMemory_)
+            return;
+        lockMemory_ = lock;
+        for (std::map<size_t, SizeClass>::iterator size=sizes_.begin(); size!=sizes_.end(); ++size) {
+            for (size_t i=0; i<size->second.free.size(); i++) {
+                unused.push_back(std::make_pair(size->second.free[i], size->first));
+                bytes_ -= lock ? size->first : ThreadPlacement::roundPages(size->first);
+            }
+            size->second.free.clear();
+        }
+    }
+    for (size_t i=0; i<unused.size(); i++)
+        free(unused[i].first, unused[i].second, !lock);
+}
+
+size_t FramePool::lockFailures()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    return lockFailures_;
+}
+
+size_t FramePool::bytes()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    return bytes_;
+}
+
+size_t FramePool::leased()
+{
+    return leased_;
+}
+
+size_t FramePool::allocated()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    return allocated_;
+}
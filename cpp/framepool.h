@@ -0,0 +1,143 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#ifndef PSD_FRAMEPOOL_H
+#define PSD_FRAMEPOOL_H
+
+#include <map>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <ossie/shared_buffer.h>
+
+class FramePool
+{
+    //process wide pool of output frame buffers
+    //
+    //the fft and psd of a frame are computed straight into a leased buffer,
+    //which is then handed to bulkio as a shared buffer - local consumers get
+    //the same memory with no copy.  Whoever drops the last reference (the
+    //sender thread, or a local consumer much later) runs the deleter, which
+    //puts the memory back on the free list for its size.
+    //
+    //a size keeps at most as many free buffers as it has leased, or the
+    //number of cores if that is more (plus one batch, see below), so the
+    //pool follows the number of frames actually in flight.  trim() frees
+    //the sizes nothing is using.
+    //
+    //each thread also keeps a few free buffers of each size to itself, so
+    //most leases and releases never touch the pool's lock.  A thread that
+    //runs out takes a batch from the shared free lists, and one that
+    //collects too many (the sender threads, which drop most frames) hands a
+    //batch back.  releaseThread() hands back the rest, for a thread that is
+    //going quiet.
+    //
+    //buffers are fftw aligned, so an fft can be run straight into them, and
+    //are zeroed by the leasing thread when they are allocated so their pages
+    //are first touched on that thread's numa node.  With setLockMemory they
+    //are allocated as whole pages of their own and mlocked; buffers from
+    //before a change are freed as they come back.
+public:
+    static FramePool& instance();
+
+    template <typename T>
+    redhawk::buffer<T> lease(size_t count)
+    {
+        size_t bytes = count*sizeof(T);
+        bool paged;
+        T* data = static_cast<T*>(acquire(bytes, paged));
+        return redhawk::buffer<T>(data, count, Deleter(bytes, paged));
+    }
+
+    //hand the calling thread's own free buffers back to the shared lists
+    void releaseThread();
+
+    //free every free buffer of a size with nothing leased
+    void trim();
+
+    //keep buffers resident with mlock
+    void setLockMemory(bool lock);
+
+    //number of times mlock has failed (usually RLIMIT_MEMLOCK)
+    size_t lockFailures();
+
+    //total bytes held, leased or free
+    size_t bytes();
+
+    //buffers currently leased
+    size_t leased();
+
+    //buffers allocated so far - flat once the free lists cover the frames
+    //in flight
+    size_t allocated();
+
+private:
+    FramePool();
+    ~FramePool();
+
+    //paged buffers were allocated as whole pages for locking (whether or
+    //not mlock worked) and are freed differently
+    struct Deleter {
+        Deleter(size_t bytes, bool paged) : bytes_(bytes), paged_(paged) {}
+        void operator()(void* data) const {FramePool::instance().release(data, bytes_, paged_);}
+        size_t bytes_;
+        bool paged_;
+    };
+
+    struct Buffer {
+        Buffer(void* data, bool paged) : data(data), paged(paged) {}
+        void* data;
+        bool paged;
+    };
+    typedef std::vector<Buffer> BufferList;
+
+    struct SizeClass {
+        SizeClass() : leased(0) {}
+        //always of the current lockMemory_ kind
+        std::vector<void*> free;
+        //buffers out of the shared list - leased, or kept by a thread
+        size_t leased;
+    };
+
+    //a thread's own free buffers, by size
+    typedef std::map<size_t, BufferList> ThreadCache;
+
+    //buffers a thread takes or hands back at once
+    static const size_t threadBatch = 4;
+
+    void* acquire(size_t bytes, bool& paged);
+    void release(void* data, size_t bytes, bool paged);
+    ThreadCache& threadCache();
+    //back on the shared list for their size, or freed
+    void giveBack(size_t bytes, const BufferList& buffers);
+    void free(void* data, size_t bytes, bool paged);
+    static void threadExit(ThreadCache* cache);
+
+    boost::mutex lock_;
+    std::map<size_t, SizeClass> sizes_;
+    size_t minFree_;
+    size_t bytes_;
+    volatile size_t leased_;
+    size_t allocated_;
+    volatile bool lockMemory_;
+    size_t lockFailures_;
+    boost::thread_specific_ptr<ThreadCache> cache_;
+};
+
+#endif
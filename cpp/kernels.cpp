@@ -0,0 +1,209 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "kernels.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdint.h>
+
+namespace {
+    struct RuntimeLength {
+        explicit RuntimeLength(size_t len) : n(len) {}
+        size_t value() const {return n;}
+        size_t n;
+    };
+
+    template <size_t N>
+    struct FixedLength {
+        explicit FixedLength(size_t) {}
+        size_t value() const {return N;}
+    };
+
+    //loops are split at the last multiple of this many bins so a fixed
+    //length gives the compiler a whole number of simd blocks plus a known
+    //tail (the extra nyquist bin of a real fft) - gcc only vectorizes at -O2
+    //when it can see that
+    const size_t block = 8;
+
+    inline size_t whole(size_t n)
+    {
+        return n-n%block;
+    }
+
+    inline float norm(const std::complex<float>& x)
+    {
+        return x.real()*x.real()+x.imag()*x.imag();
+    }
+
+    template <class Length>
+    void magnitude(const std::complex<float>* __restrict__ in, float* __restrict__ out, size_t len)
+    {
+        const size_t n = Length(len).value();
+        for (size_t i=0; i<whole(n); i++)
+            out[i] = norm(in[i]);
+        for (size_t i=whole(n); i<n; i++)
+            out[i] = norm(in[i]);
+    }
+
+    template <class Length>
+    void magnitudeShifted(const std::complex<float>* __restrict__ in, float* __restrict__ out, size_t len)
+    {
+        const size_t n = Length(len).value();
+        const size_t half = n/2;
+        const size_t rest = n-half;
+        for (size_t i=0; i<half; i++)
+            out[i] = norm(in[i+rest]);
+        for (size_t i=0; i<rest; i++)
+            out[i+half] = norm(in[i]);
+    }
+
+    template <class Length>
+    float* magnitudeInPlace(std::complex<float>* data, size_t len)
+    {
+        //out[i] only overwrites the first half of data[i/2], so each block of
+        //bins can be read in full before it is written back over itself
+        const size_t n = Length(len).value();
+        float* out = reinterpret_cast<float*>(data);
+        for (size_t i=0; i<whole(n); i+=block) {
+            float tmp[block];
+            for (size_t j=0; j<block; j++)
+                tmp[j] = norm(data[i+j]);
+            for (size_t j=0; j<block; j++)
+                out[i+j] = tmp[j];
+        }
+        for (size_t i=whole(n); i<n; i++)
+            out[i] = norm(data[i]);
+        return out;
+    }
+
+    template <class Length>
+    void accumulate(float* __restrict__ sum, const float* __restrict__ in, size_t len)
+    {
+        const size_t n = Length(len).value();
+        for (size_t i=0; i<whole(n); i++)
+            sum[i] += in[i];
+        for (size_t i=whole(n); i<n; i++)
+            sum[i] += in[i];
+    }
+
+    template <class Length>
+    void mean(const float* __restrict__ sum, float scale, float* __restrict__ out, size_t len)
+    {
+        const size_t n = Length(len).value();
+        for (size_t i=0; i<whole(n); i++)
+            out[i] = sum[i]*scale;
+        for (size_t i=whole(n); i<n; i++)
+            out[i] = sum[i]*scale;
+    }
+
+    inline float log2Normal(float x)
+    {
+        //log2 of a positive, normal, finite float without a libm call, so it
+        //vectorizes.  x = m*2^e with m in [sqrt(.5),sqrt(2)), and
+        //ln(m) = 2*atanh(t) with t = (m-1)/(m+1), |t| < 0.172 - the series
+        //below is good to well under a float ulp
+        union {
+            float f;
+            int32_t i;
+        } bits;
+        bits.f = x;
+        int32_t mantissa = bits.i & 0x007fffff;
+        int32_t big = mantissa > 0x003504f3;
+        int32_t e = ((bits.i >> 23) & 0xff) - 127 + big;
+        bits.i = mantissa | (0x3f800000 - (big << 23));
+        float m = bits.f;
+        float t = (m-1.0f)/(m+1.0f);
+        float t2 = t*t;
+        float ln = 2.0f*t*(1.0f+t2*(1.0f/3+t2*(1.0f/5+t2*(1.0f/7+t2*(1.0f/9)))));
+        return float(e)+ln*1.44269504f;
+    }
+
+    template <class Length>
+    void log(float* data, float coeff, size_t len)
+    {
+        //coeff*log10(x) = coeff*log10(2)*log2(x).  Frames holding a zero,
+        //denormal, infinite or nan bin (rare in a psd) take the libm path so
+        //those bins come out exactly as log10 gives them
+        const size_t n = Length(len).value();
+        int special = 0;
+        for (size_t i=0; i<whole(n); i++)
+            special |= (data[i] < FLT_MIN) | !(data[i] <= FLT_MAX);
+        for (size_t i=whole(n); i<n; i++)
+            special |= (data[i] < FLT_MIN) | !(data[i] <= FLT_MAX);
+        if (special) {
+            for (size_t i=0; i<n; i++)
+                data[i] = coeff*log10(data[i]);
+            return;
+        }
+        const float scale = coeff*0.301029995664f;
+        for (size_t i=0; i<whole(n); i++)
+            data[i] = scale*log2Normal(data[i]);
+        for (size_t i=whole(n); i<n; i++)
+            data[i] = scale*log2Normal(data[i]);
+    }
+
+    template <class Length>
+    PsdKernels kernels(size_t fixedSize)
+    {
+        PsdKernels k;
+        k.magnitude = &magnitude<Length>;
+        k.magnitudeShifted = &magnitudeShifted<Length>;
+        k.magnitudeInPlace = &magnitudeInPlace<Length>;
+        k.accumulate = &accumulate<Length>;
+        k.mean = &mean<Length>;
+        k.log = &log<Length>;
+        k.fixedSize = fixedSize;
+        return k;
+    }
+
+    //real input gives N/2+1 bins, complex input N
+    #define PSD_FIXED_KERNELS(N) \
+        kernels<FixedLength<N/2+1> >(N), \
+        kernels<FixedLength<N> >(N)
+
+    const PsdKernels fixedKernels[] = {
+        PSD_FIXED_KERNELS(1024),
+        PSD_FIXED_KERNELS(4096),
+        PSD_FIXED_KERNELS(8192),
+        PSD_FIXED_KERNELS(32768)
+    };
+    const size_t fixedLengths[] = {
+        1024/2+1, 1024,
+        4096/2+1, 4096,
+        8192/2+1, 8192,
+        32768/2+1, 32768
+    };
+
+    const PsdKernels genericKernels = kernels<RuntimeLength>(0);
+}
+
+const PsdKernels& PsdKernels::select(size_t len)
+{
+    const size_t* end = fixedLengths+sizeof(fixedLengths)/sizeof(fixedLengths[0]);
+    const size_t* fixed = std::find(fixedLengths, end, len);
+    if (fixed==end)
+        return genericKernels;
+    return fixedKernels[fixed-fixedLengths];
+}
+
+const PsdKernels& PsdKernels::generic()
+{
+    return genericKernels;
+}
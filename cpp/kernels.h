@@ -0,0 +1,57 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_KERNELS_H
+#define PSD_KERNELS_H
+
+#include <complex>
+#include <cstddef>
+
+struct PsdKernels
+{
+    //the per-bin stages that follow the fft
+    //
+    //every stage is written once against a length type: compiled with a
+    //FixedLength the trip count is a constant, so the loops vectorize and
+    //unroll with no runtime remainder handling, while RuntimeLength gives
+    //the generic version.  select() picks the fixed versions for the output lengths of
+    //the common fft sizes (real and complex) and the generic ones otherwise.
+    //
+    //len is always the number of bins
+    void (*magnitude)(const std::complex<float>* in, float* out, size_t len);
+    //complex input - also moves dc to the middle of the output
+    void (*magnitudeShifted)(const std::complex<float>* in, float* out, size_t len);
+    //natural order magnitudes written over the input - returns the output
+    float* (*magnitudeInPlace)(std::complex<float>* data, size_t len);
+    //sum += in
+    void (*accumulate)(float* sum, const float* in, size_t len);
+    //out = sum*scale
+    void (*mean)(const float* sum, float scale, float* out, size_t len);
+    //data = coeff*log10(data) - positive normal bins use an inline log
+    //that vectorizes (within a few ulp of log10), anything else goes
+    //through log10 itself
+    void (*log)(float* data, float coeff, size_t len);
+
+    //fft size the kernels are specialized for, 0 for the generic versions
+    size_t fixedSize;
+
+    static const PsdKernels& select(size_t len);
+    static const PsdKernels& generic();
+};
+
+#endif
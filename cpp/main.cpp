@@ -17,11 +17,18 @@
  */
 
 #include <iostream>
+#include <cstring>
 #include "ossie/ossieSupport.h"
 
 #include "psd.h"
+#include "replay.h"
 int main(int argc, char* argv[])
 {
+    // offline mode - no domain, just run the psd pipeline over a file
+    if (argc > 1 && strcmp(argv[1], "--replay") == 0) {
+        return replayMain(argc-1, argv+1);
+    }
+
     psd_i* psd_servant;
     Component::start_component(psd_servant, argc, argv);
     return 0;
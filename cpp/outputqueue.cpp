@@ -0,0 +1,300 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "outputqueue.h"
+
+#include <algorithm>
+#include <ossie/PropertyMap.h>
+#include "framepool.h"
+#include "kernels.h"
+
+namespace {
+    //the packets are variable length, so the bins they hold are described
+    //by keywords
+    BULKIO::StreamSRI waterfallSRI(const BULKIO::StreamSRI& psdSRI)
+    {
+        BULKIO::StreamSRI sri = psdSRI;
+        redhawk::PropertyMap& keywords = redhawk::PropertyMap::cast(sri.keywords);
+        keywords["WATERFALL_CODEC"] = std::string("PSDW");
+        keywords["WATERFALL_BINS"] = CORBA::Long(psdSRI.subsize);
+        keywords["WATERFALL_XSTART"] = psdSRI.xstart;
+        keywords["WATERFALL_XDELTA"] = psdSRI.xdelta;
+        sri.subsize = 0;
+        return sri;
+    }
+}
+
+OutputQueue::OutputQueue(bulkio::OutFloatStream fftStream, bulkio::OutFloatStream psdStream,
+                         bulkio::OutOctetStream waterfallStream) :
+    outFFT_(fftStream),
+    outPSD_(psdStream),
+    outWaterfall_(waterfallStream),
+    trace_("psd sender "+psdStream.streamID()),
+    maxDepth_(1),
+    policy_(BLOCK),
+    dropped_(0),
+    running_(false),
+    sender_(NULL),
+    sending_(false),
+    senderBytes_(0),
+    sriPending_(false),
+    logCoeff_(0)
+{
+}
+
+OutputQueue::~OutputQueue()
+{
+    stop();
+    release();
+    for (std::deque<Entry*>::iterator i=queue_.begin(); i!=queue_.end(); ++i)
+        delete *i;
+}
+
+bool OutputQueue::parsePolicy(const std::string& name, Policy& policy)
+{
+    if (name=="block") {
+        policy = BLOCK;
+    } else if (name=="drop_oldest") {
+        policy = DROP_OLDEST;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void OutputQueue::configure(size_t depth, Policy policy)
+{
+    boost::mutex::scoped_lock lock(lock_);
+    maxDepth_ = std::max(depth, size_t(1));
+    policy_ = policy;
+    //a blocked producer may now fit
+    notFull_.notify_all();
+}
+
+void OutputQueue::start()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    if (sender_)
+        return;
+    running_ = true;
+    sender_ = new boost::thread(&OutputQueue::run, this);
+}
+
+void OutputQueue::stop()
+{
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        if (!sender_)
+            return;
+        running_ = false;
+        notEmpty_.notify_all();
+    }
+    sender_->join();
+    delete sender_;
+    sender_ = NULL;
+}
+
+void OutputQueue::sri(const BULKIO::StreamSRI& fftSRI, const BULKIO::StreamSRI& psdSRI)
+{
+    fftSRI_ = fftSRI;
+    psdSRI_ = psdSRI;
+    sriPending_ = true;
+}
+
+void OutputQueue::waterfall(const WaterfallEncoder::Settings& settings, float logCoeff)
+{
+    waterfall_ = settings;
+    logCoeff_ = logCoeff;
+}
+
+OutputQueue::Entry* OutputQueue::entry()
+{
+    //called with lock_ held
+    if (free_.empty())
+        return new Entry();
+    Entry* entry = free_.back();
+    free_.pop_back();
+    return entry;
+}
+
+void OutputQueue::recycle(Entry* entry)
+{
+    //called with lock_ held - keep enough entries to refill the queue.  The
+    //frames go back to the pool once everyone else is done with them
+    entry->psd = redhawk::shared_buffer<float>();
+    entry->fft = redhawk::shared_buffer<std::complex<float> >();
+    if (free_.size() < maxDepth_+1)
+        free_.push_back(entry);
+    else
+        delete entry;
+}
+
+void OutputQueue::push(const redhawk::shared_buffer<float>& psd, const redhawk::shared_buffer<std::complex<float> >& fft,
+                       const BULKIO::PrecisionUTCTime& time, bool writePsd, bool encodePsd)
+{
+    bool hasPsd = !psd.empty() && (writePsd || encodePsd);
+    if (!hasPsd && fft.empty() && !sriPending_)
+        return;
+
+    Entry* next;
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        next = entry();
+    }
+    next->hasSRI = sriPending_;
+    if (sriPending_) {
+        next->fftSRI = fftSRI_;
+        next->psdSRI = psdSRI_;
+        sriPending_ = false;
+    }
+    if (hasPsd)
+        next->psd = psd;
+    next->fft = fft;
+    next->time = time;
+    next->writePsd = writePsd;
+    next->encodePsd = encodePsd;
+    next->waterfall = waterfall_;
+    next->logCoeff = logCoeff_;
+
+    boost::mutex::scoped_lock lock(lock_);
+    if (policy_==BLOCK) {
+        while (running_ && queue_.size()>=maxDepth_)
+            notFull_.wait(lock);
+    } else {
+        while (queue_.size()>=maxDepth_) {
+            Entry* oldest = queue_.front();
+            queue_.pop_front();
+            //keep the sri - the next frame becomes the one that carries it
+            Entry* following = queue_.empty() ? next : queue_.front();
+            if (oldest->hasSRI && !following->hasSRI) {
+                following->hasSRI = true;
+                following->fftSRI = oldest->fftSRI;
+                following->psdSRI = oldest->psdSRI;
+            }
+            recycle(oldest);
+            dropped_++;
+        }
+    }
+    queue_.push_back(next);
+    notEmpty_.notify_one();
+}
+
+void OutputQueue::run()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    while (true) {
+        //the frames this thread has let go of are wanted by the processing
+        //thread - hand them back once nothing has come for a while (a steady
+        //stream empties the queue after every frame)
+        if (running_ && queue_.empty() && !notEmpty_.timed_wait(lock, boost::posix_time::milliseconds(100)))
+            FramePool::instance().releaseThread();
+        while (running_ && queue_.empty())
+            notEmpty_.wait(lock);
+        if (queue_.empty())
+            break;
+        Entry* current = queue_.front();
+        queue_.pop_front();
+        notFull_.notify_one();
+        sending_ = true;
+
+        lock.unlock();
+        uint64_t stageStart = trace_.start(StageTrace::WRITE);
+        if (current->hasSRI) {
+            outFFT_.sri(current->fftSRI);
+            outPSD_.sri(current->psdSRI);
+            outWaterfall_.sri(waterfallSRI(current->psdSRI));
+            //a new sri (which includes a new waterfall connection) starts
+            //the waterfall over with a keyframe
+            encoder_.reset();
+        }
+        if (current->writePsd && !current->psd.empty())
+            outPSD_.write(current->psd, current->time);
+        if (!current->fft.empty())
+            outFFT_.write(current->fft, current->time);
+        if (current->encodePsd && !current->psd.empty())
+            encode(*current);
+        trace_.stop(StageTrace::WRITE, stageStart);
+        size_t bytes = encoder_.memoryBytes() + db_.capacity()*sizeof(float) + encoded_.capacity() + trace_.memoryBytes();
+        lock.lock();
+
+        sending_ = false;
+        senderBytes_ = bytes;
+        recycle(current);
+    }
+}
+
+void OutputQueue::encode(const Entry& entry)
+{
+    //the codec works in dB, whatever the scale of the psd output
+    size_t len = entry.psd.size();
+    const float* db = entry.psd.data();
+    if (entry.logCoeff!=10) {
+        db_.assign(db, db+len);
+        if (entry.logCoeff>0) {
+            float scale = 10/entry.logCoeff;
+            for (size_t i=0; i<len; i++)
+                db_[i] *= scale;
+        } else {
+            PsdKernels::select(len).log(&db_[0], 10, len);
+        }
+        db = &db_[0];
+    }
+    if (entry.waterfall!=encoder_.settings())
+        encoder_.configure(entry.waterfall);
+    encoded_.clear();
+    encoder_.encode(db, len, encoded_);
+    outWaterfall_.write(&encoded_[0], encoded_.size(), entry.time);
+}
+
+void OutputQueue::release()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    for (size_t i=0; i<free_.size(); i++)
+        delete free_[i];
+    free_.clear();
+    FramePool::instance().trim();
+    //the sender only touches its buffers while sending_ is set
+    if (!sending_ && queue_.empty()) {
+        encoder_ = WaterfallEncoder();
+        std::vector<float>().swap(db_);
+        std::vector<unsigned char>().swap(encoded_);
+        senderBytes_ = 0;
+    }
+}
+
+size_t OutputQueue::depth()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    return queue_.size();
+}
+
+size_t OutputQueue::dropped()
+{
+    boost::mutex::scoped_lock lock(lock_);
+    return dropped_;
+}
+
+size_t OutputQueue::memoryBytes()
+{
+    //frames that have been sent belong to the FramePool
+    boost::mutex::scoped_lock lock(lock_);
+    size_t bytes = senderBytes_;
+    for (size_t i=0; i<queue_.size(); i++)
+        bytes += queue_[i]->psd.size()*sizeof(float) + queue_[i]->fft.size()*sizeof(std::complex<float>);
+    return bytes;
+}
@@ -0,0 +1,145 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_OUTPUTQUEUE_H
+#define PSD_OUTPUTQUEUE_H
+
+#include <complex>
+#include <deque>
+#include <vector>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <bulkio/bulkio.h>
+#include "trace.h"
+#include "waterfallcodec.h"
+
+class OutputQueue
+{
+    //bounded queue between a PsdProcessor and its output streams
+    //
+    //each pushed frame is queued by reference and written to the bulkio
+    //streams by a sender thread, so a slow consumer only holds up the
+    //sender.  When the queue is full the processing thread either waits for
+    //room (BLOCK) or the oldest queued frame is thrown away (DROP_OLDEST).
+    //
+    //sri updates travel with the frame that follows them and are never
+    //dropped - if the frame carrying one is dropped the sri moves on to the
+    //next frame in the queue
+    //
+    //the compressed waterfall is encoded by the sender, so frames dropped
+    //from the queue never break the chain of delta coded frames
+    //
+    //the frames are buffers leased from the FramePool, which the processing
+    //thread computed straight into.  The queue entry, the streams and any
+    //local consumers share them by reference count, so they are never copied
+    //on the way through, and each goes back to the pool once the last of them
+    //lets go
+public:
+    enum Policy {
+        BLOCK,
+        DROP_OLDEST
+    };
+
+    OutputQueue(bulkio::OutFloatStream fftStream, bulkio::OutFloatStream psdStream,
+                bulkio::OutOctetStream waterfallStream);
+    ~OutputQueue();
+
+    void configure(size_t depth, Policy policy);
+
+    void start();
+    //sends everything still queued, then stops the sender
+    void stop();
+
+    //sri for the next pushed frame
+    void sri(const BULKIO::StreamSRI& fftSRI, const BULKIO::StreamSRI& psdSRI);
+
+    //waterfall settings for the next pushed frame - logCoeff is the scale of
+    //the pushed psd (0 for linear power)
+    void waterfall(const WaterfallEncoder::Settings& settings, float logCoeff);
+
+    //queue one frame - either output may be empty.  The psd goes to the psd
+    //stream if writePsd is set and to the waterfall stream if encodePsd is set.
+    //The buffers must not be modified after this
+    void push(const redhawk::shared_buffer<float>& psd, const redhawk::shared_buffer<std::complex<float> >& fft,
+              const BULKIO::PrecisionUTCTime& time, bool writePsd=true, bool encodePsd=false);
+
+    //free the recycled entries and the unused frame buffers - for idle streams
+    void release();
+
+    size_t depth();
+    size_t dropped();
+    size_t memoryBytes();
+
+    //the policy property values
+    static bool parsePolicy(const std::string& name, Policy& policy);
+
+private:
+    struct Entry {
+        bool hasSRI;
+        BULKIO::StreamSRI fftSRI;
+        BULKIO::StreamSRI psdSRI;
+        redhawk::shared_buffer<float> psd;
+        redhawk::shared_buffer<std::complex<float> > fft;
+        BULKIO::PrecisionUTCTime time;
+        bool writePsd;
+        bool encodePsd;
+        WaterfallEncoder::Settings waterfall;
+        float logCoeff;
+    };
+
+    void run();
+    void encode(const Entry& entry);
+    Entry* entry();
+    void recycle(Entry* entry);
+
+    bulkio::OutFloatStream outFFT_;
+    bulkio::OutFloatStream outPSD_;
+    bulkio::OutOctetStream outWaterfall_;
+
+    // stage timing for the sender thread
+    StageTrace trace_;
+
+    boost::mutex lock_;
+    boost::condition_variable notEmpty_;
+    boost::condition_variable notFull_;
+    std::deque<Entry*> queue_;
+    std::vector<Entry*> free_;
+    size_t maxDepth_;
+    Policy policy_;
+    size_t dropped_;
+    bool running_;
+    boost::thread* sender_;
+
+    //waterfall coding - only touched by the sender, or under lock_ while it
+    //is not sending
+    bool sending_;
+    WaterfallEncoder encoder_;
+    std::vector<float> db_;
+    std::vector<unsigned char> encoded_;
+    size_t senderBytes_;
+
+    //staged by sri() for the next push - only touched by the processing thread
+    bool sriPending_;
+    BULKIO::StreamSRI fftSRI_;
+    BULKIO::StreamSRI psdSRI_;
+    WaterfallEncoder::Settings waterfall_;
+    float logCoeff_;
+};
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "pipeline.h"
+
+#include <algorithm>
+#include <cstring>
+
+PsdPipeline::PsdPipeline(size_t fftSize, size_t numAvg) :
+    fftSz_(fftSize),
+    numAvg_(numAvg),
+    poolWidth_(0),
+    pooling_(POOL_MEAN),
+    kernels_(&PsdKernels::generic()),
+    configured_(false),
+    complex_(false),
+    scratch_(NULL),
+    fftFrames_(NULL),
+    frames_(0),
+    fftOut_(NULL),
+    fftShifted_(false),
+    fftValid_(false),
+    avgCount_(0)
+{
+}
+
+PsdPipeline::~PsdPipeline()
+{
+    done();
+}
+
+void PsdPipeline::setFftSize(size_t fftSize)
+{
+    fftSz_ = fftSize;
+    avgCount_ = 0;
+    if (configured_){
+        transform_.setup(fftSz_, complex_, settings_[complex_]);
+        kernels_ = &PsdKernels::select(transform_.outSize());
+    }
+}
+
+void PsdPipeline::setTransform(const TransformSettings& real, const TransformSettings& complex)
+{
+    //the averaging carries on - only the way the fft is computed changes.
+    //The plans are made by the next run(), so setting this before a new
+    //fft size does not plan the old size again
+    settings_[0] = real;
+    settings_[1] = complex;
+}
+
+void PsdPipeline::setNumAvg(size_t numAvg)
+{
+    numAvg_ = numAvg;
+    avgCount_ = 0;
+}
+
+void PsdPipeline::setPooling(size_t width, Pooling pooling)
+{
+    poolWidth_ = width;
+    pooling_ = pooling;
+}
+
+size_t PsdPipeline::psdSize(size_t bins) const
+{
+    if (poolWidth_>0 && poolWidth_<bins)
+        return poolWidth_;
+    return bins;
+}
+
+bool PsdPipeline::parsePooling(const std::string& name, Pooling& pooling)
+{
+    if (name=="mean")
+        pooling = POOL_MEAN;
+    else if (name=="max")
+        pooling = POOL_MAX;
+    else
+        return false;
+    return true;
+}
+
+void PsdPipeline::flush()
+{
+    //the rest of the processing state is flushed on the next frame
+    configured_ = false;
+}
+
+void PsdPipeline::release()
+{
+    flush();
+    done();
+    //the thread is going idle - let its kept arena go to another thread
+    ScratchPool::instance().releaseThread();
+    std::vector<float>().swap(psdSum_);
+    avgCount_ = 0;
+}
+
+void PsdPipeline::run(const float* data, size_t count, bool complex, std::complex<float>* fftOut, size_t frames)
+{
+    // setup for the frame type - any transition starts the averaging over
+    if (!configured_ || complex!=complex_){
+        configured_ = true;
+        complex_ = complex;
+        transform_.setup(fftSz_, complex_, settings_[complex_]);
+        kernels_ = &PsdKernels::select(transform_.outSize());
+        avgCount_ = 0;
+    } else {
+        transform_.setup(fftSz_, complex_, settings_[complex_]);
+    }
+    if (!scratch_)
+        scratch_ = ScratchPool::instance().lease();
+
+    size_t floatsPerSample = complex_ ? 2 : 1;
+    size_t padFloats = count<fftSz_ ? fftSz_*floatsPerSample : 0;
+    ScratchPool::instance().prepare(scratch_, transform_.outSize()*(fftOut ? 1 : frames), padFloats);
+    if (padFloats){
+        float* padded = &scratch_->padded[0];
+        memcpy(padded, data, count*floatsPerSample*sizeof(float));
+        std::fill(padded+count*floatsPerSample, padded+padFloats, 0.0f);
+        data = padded;
+    }
+    fftFrames_ = fftOut ? fftOut : &scratch_->fftOut[0];
+    frames_ = frames;
+    transform_.run(data, fftFrames_, frames);
+    selectFrame(0);
+}
+
+void PsdPipeline::selectFrame(size_t frame)
+{
+    if (frame>=frames_)
+        return;
+    fftOut_ = fftFrames_+frame*transform_.outSize();
+    fftShifted_ = false;
+    fftValid_ = true;
+}
+
+void PsdPipeline::done()
+{
+    if (scratch_){
+        ScratchPool::instance().release(scratch_);
+        scratch_ = NULL;
+    }
+    fftFrames_ = NULL;
+    fftOut_ = NULL;
+    frames_ = 0;
+}
+
+void PsdPipeline::relocate()
+{
+    std::vector<float>(psdSum_).swap(psdSum_);
+}
+
+size_t PsdPipeline::memoryBytes() const
+{
+    return psdSum_.capacity()*sizeof(float);
+}
+
+float* PsdPipeline::magnitude(bool inPlace, float* dest)
+{
+    size_t len = transform_.outSize();
+    if (inPlace && !dest){
+        float* out = kernels_->magnitudeInPlace(fftOut_, len);
+        if (complex_ && !fftShifted_){
+            //put dc in the middle of the output
+            std::rotate(out, out+(len-len/2), out+len);
+        }
+        fftValid_ = false;
+        return out;
+    }
+
+    float* out = dest ? dest : &scratch_->psdOut[0];
+    if (complex_ && !fftShifted_){
+        //put dc in the middle of the output
+        kernels_->magnitudeShifted(fftOut_, out, len);
+    } else {
+        kernels_->magnitude(fftOut_, out, len);
+    }
+    return out;
+}
+
+void PsdPipeline::accumulate(float* psd, size_t len, float* mean)
+{
+    //add this frame's psd to the running sum - on the last frame of the
+    //average the mean is written to mean, which may be the frame's psd
+    if (avgCount_==0 || psdSum_.size()!=len){
+        psdSum_.assign(psd, psd+len);
+        avgCount_ = 1;
+    } else {
+        kernels_->accumulate(&psdSum_[0], psd, len);
+        avgCount_++;
+    }
+    if (avgCount_>=numAvg_){
+        kernels_->mean(&psdSum_[0], 1.0f/numAvg_, mean, len);
+        avgCount_ = 0;
+    }
+}
+
+size_t PsdPipeline::pool(float* psd, size_t len)
+{
+    //each output bin starts at or after its own index, so the pooled bins can
+    //be written over the input as it is read
+    size_t width = psdSize(len);
+    if (width==len)
+        return len;
+    size_t start = 0;
+    for (size_t i=0; i<width; i++){
+        size_t end = (i+1)*len/width;
+        float value = psd[start];
+        if (pooling_==POOL_MAX){
+            for (size_t j=start+1; j<end; j++)
+                value = std::max(value, psd[j]);
+        } else {
+            for (size_t j=start+1; j<end; j++)
+                value += psd[j];
+            value /= end-start;
+        }
+        psd[i] = value;
+        start = end;
+    }
+    return width;
+}
+
+bool PsdPipeline::psd(float logCoeff, float*& out, size_t& len, bool keepFft, float* dest)
+{
+    out = NULL;
+    len = 0;
+    if (!configured_ || !scratch_ || !fftValid_)
+        return false;
+    //when averaging only the mean goes to dest
+    bool averaging = numAvg_ > 1;
+    float* psd = magnitude(!keepFft, averaging ? NULL : dest);
+    size_t psdLen = transform_.outSize();
+    if (averaging){
+        float* mean = dest ? dest : psd;
+        accumulate(psd, psdLen, mean);
+        if (avgCount_!=0)
+            return false;
+        psd = mean;
+    }
+    out = psd;
+    len = pool(psd, psdLen);
+    //take the log of the output if necessary
+    if (logCoeff > 0){
+        const PsdKernels& kernels = len==psdLen ? *kernels_ : PsdKernels::select(len);
+        kernels.log(out, logCoeff, len);
+    }
+    return len>0;
+}
+
+bool PsdPipeline::psdDue() const
+{
+    if (numAvg_ <= 1)
+        return true;
+    //the same restart test as accumulate()
+    if (avgCount_==0 || psdSum_.size()!=transform_.outSize())
+        return false;
+    return avgCount_+1 >= numAvg_;
+}
+
+std::complex<float>* PsdPipeline::fft(size_t& len)
+{
+    len = 0;
+    if (!configured_ || !scratch_ || !fftValid_)
+        return NULL;
+    len = transform_.outSize();
+    if (complex_ && !fftShifted_){
+        //put dc in the middle of the output
+        std::rotate(fftOut_, fftOut_+(len-len/2), fftOut_+len);
+        fftShifted_ = true;
+    }
+    return fftOut_;
+}
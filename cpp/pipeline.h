@@ -0,0 +1,149 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_PIPELINE_H
+#define PSD_PIPELINE_H
+
+#include <complex>
+#include <string>
+#include <vector>
+#include "fft.h"
+#include "kernels.h"
+#include "scratch.h"
+#include "transform.h"
+
+class PsdPipeline
+{
+    //the frame processing shared by PsdProcessor and the offline replay mode
+    //give it one frame of time domain data and it does the fft, the psd,
+    //the psd averaging, bin pooling and the db conversion
+    //
+    //handles real/complex transitions - any transition flushes the averaging state
+    //
+    //the only memory a pipeline owns is the psd averaging sum.  The fft plans
+    //are shared and the working buffers are leased from the ScratchPool by
+    //run() and handed back by done()
+public:
+    //how neighbouring psd bins are combined when the psd is pooled
+    enum Pooling {
+        POOL_MEAN,
+        POOL_MAX
+    };
+
+    PsdPipeline(size_t fftSize, size_t numAvg);
+    ~PsdPipeline();
+
+    void setFftSize(size_t fftSize);
+    void setNumAvg(size_t numAvg);
+    size_t fftSize() const {return fftSz_;}
+    //fft bins for a frame of real or complex data
+    size_t fftBins(bool complex) const {return complex ? fftSz_ : fftSz_/2+1;}
+
+    //how the fft plans are made and run for real and for complex frames
+    void setTransform(const TransformSettings& real, const TransformSettings& complex);
+    const TransformSettings& transformSettings(bool complex) const {return settings_[complex];}
+
+    //pool the averaged psd down to width bins before the db conversion - 0,
+    //or a width that is not less than the number of bins, keeps every bin.
+    //Output bin i combines bins [i*bins/width, (i+1)*bins/width)
+    void setPooling(size_t width, Pooling pooling);
+    //number of psd output bins for a frame of bins fft bins
+    size_t psdSize(size_t bins) const;
+
+    //the pooling property values
+    static bool parsePooling(const std::string& name, Pooling& pooling);
+
+    //drop all processing state - the next frame starts from scratch
+    void flush();
+
+    //flush and free the averaging sum as well
+    void release();
+
+    //copy the averaging sum into memory first touched by the calling thread -
+    //after a thread moves to another numa node
+    void relocate();
+
+    //transform one frame - data is used in place and never modified
+    //count is the number of samples (complex samples if complex is true);
+    //short frames are zero padded out to the fft size
+    //
+    //the fft goes to fftOut if it is given (fftBins(complex) long and fftw
+    //aligned), otherwise to a scratch buffer
+    //
+    //frames > 1 transforms that many whole frames back to back (count is then
+    //frames*fftSize, and fftOut frames*fftBins long).  psd() and fft() work
+    //on frame 0 until selectFrame() moves them on
+    void run(const float* data, size_t count, bool complex, std::complex<float>* fftOut=NULL, size_t frames=1);
+    void selectFrame(size_t frame);
+
+    //average and scale the psd of the last frame
+    //returns false if no psd frame is ready yet (still averaging)
+    //
+    //if the fft is not wanted the psd is computed in place over the fft output,
+    //which saves the separate psd buffer - fft() then returns NULL for this frame
+    //
+    //if dest is given (fftBins() long) the psd is written there instead, and
+    //out points into it
+    bool psd(float logCoeff, float*& out, size_t& len, bool keepFft=true, float* dest=NULL);
+
+    //true if the next psd() gives a frame, false if it only adds to the
+    //average - so a dest is only needed on the frame that completes it
+    bool psdDue() const;
+
+    //complex fft of the last frame
+    std::complex<float>* fft(size_t& len);
+
+    //finished with the last frame - the buffers returned by psd() and fft()
+    //go back to the pool
+    void done();
+
+    //bytes owned by this pipeline (not counting leased scratch)
+    size_t memoryBytes() const;
+
+private:
+    float* magnitude(bool inPlace, float* dest);
+    void accumulate(float* psd, size_t len, float* mean);
+    size_t pool(float* psd, size_t len);
+
+    size_t fftSz_;
+    size_t numAvg_;
+    size_t poolWidth_;
+    Pooling pooling_;
+
+    // fft of the current frame type - not set up until the first frame
+    // [0] for real frames, [1] for complex
+    TransformSettings settings_[2];
+    FrameTransform transform_;
+    const PsdKernels* kernels_;
+    bool configured_;
+    bool complex_;
+
+    // working buffers for the current frame
+    ScratchArena* scratch_;
+    std::complex<float>* fftFrames_;
+    size_t frames_;
+    std::complex<float>* fftOut_;
+    bool fftShifted_;
+    bool fftValid_;
+
+    // for psd averaging
+    std::vector<float> psdSum_;
+    size_t avgCount_;
+};
+
+#endif
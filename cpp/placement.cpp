@@ -0,0 +1,189 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "placement.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <new>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+#include <boost/thread/once.hpp>
+
+namespace {
+    //cpu number -> numa node, read once from sysfs
+    std::vector<int> cpuNodes;
+    boost::once_flag cpuNodesOnce = BOOST_ONCE_INIT;
+
+    //linux cpu list syntax, eg "0-3,8,10-11" - returns false if malformed
+    bool parseCpuList(const char* pos, cpu_set_t& cpus)
+    {
+        CPU_ZERO(&cpus);
+        while (*pos) {
+            char* end;
+            long first = strtol(pos, &end, 10);
+            if (end==pos || first<0)
+                return false;
+            long last = first;
+            pos = end;
+            if (*pos=='-') {
+                last = strtol(++pos, &end, 10);
+                if (end==pos || last<first)
+                    return false;
+                pos = end;
+            }
+            if (last>=CPU_SETSIZE)
+                return false;
+            for (long cpu=first; cpu<=last; cpu++)
+                CPU_SET(cpu, &cpus);
+            if (*pos==',')
+                pos++;
+            else if (*pos)
+                return false;
+        }
+        return true;
+    }
+
+    void readCpuNodes()
+    {
+        //every node lists its own cpus, which holds however sparsely the cpus
+        //are numbered (offline or hot-pluggable cpus leave holes)
+        cpuNodes.assign(CPU_SETSIZE, 0);
+        DIR* dir = opendir("/sys/devices/system/node");
+        if (!dir)
+            return;
+        while (struct dirent* entry = readdir(dir)) {
+            if (strncmp(entry->d_name, "node", 4)!=0 || !isdigit(entry->d_name[4]))
+                continue;
+            int node = atoi(entry->d_name+4);
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+            FILE* file = fopen(path, "r");
+            if (!file)
+                continue;
+            char line[4096];
+            cpu_set_t cpus;
+            if (fgets(line, sizeof(line), file)) {
+                line[strcspn(line, "\n")] = 0;
+                if (parseCpuList(line, cpus)) {
+                    for (int cpu=0; cpu<CPU_SETSIZE; cpu++) {
+                        if (CPU_ISSET(cpu, &cpus))
+                            cpuNodes[cpu] = node;
+                    }
+                }
+            }
+            fclose(file);
+        }
+        closedir(dir);
+    }
+}
+
+ThreadPlacement::ThreadPlacement() :
+    pinned_(false),
+    priority_(0)
+{
+    CPU_ZERO(&cpus_);
+    //unpinning goes back to whatever the process was started with
+    if (sched_getaffinity(0, sizeof(unpinned_), &unpinned_)!=0) {
+        CPU_ZERO(&unpinned_);
+        for (int cpu=0; cpu<CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, &unpinned_);
+    }
+}
+
+bool ThreadPlacement::setCpus(const std::string& cpus)
+{
+    pinned_ = false;
+    if (!parseCpuList(cpus.c_str(), cpus_)) {
+        CPU_ZERO(&cpus_);
+        return false;
+    }
+    pinned_ = CPU_COUNT(&cpus_)>0;
+    return pinned_ || cpus.empty();
+}
+
+bool ThreadPlacement::applyAffinity() const
+{
+    const cpu_set_t& cpus = pinned_ ? cpus_ : unpinned_;
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (err) {
+        errno = err;
+        return false;
+    }
+    return true;
+}
+
+bool ThreadPlacement::applyPriority() const
+{
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    int policy = SCHED_OTHER;
+    if (priority_>0) {
+        policy = SCHED_FIFO;
+        param.sched_priority = priority_;
+    }
+    int err = pthread_setschedparam(pthread_self(), policy, &param);
+    if (err) {
+        errno = err;
+        return false;
+    }
+    return true;
+}
+
+int ThreadPlacement::currentNode()
+{
+    boost::call_once(readCpuNodes, cpuNodesOnce);
+    int cpu = sched_getcpu();
+    if (cpu<0 || size_t(cpu)>=cpuNodes.size())
+        return 0;
+    return cpuNodes[cpu];
+}
+
+bool ThreadPlacement::lockPages(const void* data, size_t bytes)
+{
+    if (!bytes)
+        return true;
+    return mlock(data, bytes)==0;
+}
+
+void ThreadPlacement::unlockPages(const void* data, size_t bytes)
+{
+    if (bytes)
+        munlock(data, bytes);
+}
+
+size_t ThreadPlacement::roundPages(size_t bytes)
+{
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    return std::max((bytes+pageSize-1)/pageSize, size_t(1))*pageSize;
+}
+
+void* ThreadPlacement::allocatePages(size_t bytes)
+{
+    void* data = NULL;
+    if (posix_memalign(&data, roundPages(1), roundPages(bytes))!=0)
+        throw std::bad_alloc();
+    return data;
+}
@@ -0,0 +1,69 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_PLACEMENT_H
+#define PSD_PLACEMENT_H
+
+#include <sched.h>
+#include <string>
+
+class ThreadPlacement
+{
+    //cpu affinity and scheduling for a processing thread
+    //
+    //built from the component properties and applied by each processing
+    //thread to itself
+public:
+    ThreadPlacement();
+
+    //linux cpu list syntax, eg "0-3,8,10-11" - empty for no pinning
+    //returns false if the list is malformed or names no cpu
+    bool setCpus(const std::string& cpus);
+
+    //1-99 runs the thread SCHED_FIFO at that priority, 0 is normal scheduling
+    void setPriority(int priority) {priority_ = priority;}
+
+    //apply to the calling thread - returns false (errno set) if the system
+    //refused, usually for lack of CAP_SYS_NICE
+    bool applyAffinity() const;
+    bool applyPriority() const;
+
+    //numa node of the cpu the calling thread is on - 0 if unknown
+    static int currentNode();
+
+    //pin a buffer's pages in memory (they are faulted in by mlock)
+    //
+    //mlock works on whole pages and locks do not nest, so only use these on
+    //buffers that are page aligned and own all of their pages - see
+    //allocatePages()
+    static bool lockPages(const void* data, size_t bytes);
+    static void unlockPages(const void* data, size_t bytes);
+
+    //page aligned memory rounded up to whole pages (roundPages() bytes),
+    //released with free()
+    static void* allocatePages(size_t bytes);
+    static size_t roundPages(size_t bytes);
+
+private:
+    cpu_set_t cpus_;
+    cpu_set_t unpinned_;
+    bool pinned_;
+    int priority_;
+};
+
+#endif
@@ -27,27 +27,12 @@
 
 #include "psd.h"
 
+#include <cerrno>
+#include <cstring>
+
 PREPARE_LOGGING(PsdProcessor)
 PREPARE_LOGGING(psd_i)
 
-/****************************************************************
- ****************************************************************
- **                                                            **
- **                     Helper Methods                         **
- **                                                            **
- ****************************************************************
- ****************************************************************/
-
-void copyVec(const bulkio::FloatDataBlock &block, RealFFTWVector &out){
-    out.resize(block.size());
-    memcpy(&out[0], block.data(), out.size()*sizeof(float));
-}
-
-void copyVec(const bulkio::FloatDataBlock &block, ComplexFFTWVector &out){
-    out.resize(block.cxsize());
-    memcpy(&out[0], block.data(), out.size()*sizeof(std::complex<float>));
-}
-
 /****************************************************************
  ****************************************************************
  **                                                            **
@@ -58,97 +43,65 @@ void copyVec(const bulkio::FloatDataBlock &block, ComplexFFTWVector &out){
 PsdProcessor::PsdProcessor(bulkio::InFloatStream inStream,
                     bulkio::OutFloatStream fftStream,
                     bulkio::OutFloatStream psdStream,
-                    size_t fftSize,
-                    int overlap,
-                    size_t numAvg,
-                    float logCoeff,
-                    bool doFFT,
-                    bool doPSD,
-                    bool rfFreqUnits,
+                    bulkio::OutOctetStream waterfallStream,
+                    ConfigPublisher& config,
+                    CrossSpectra& cross,
                     float delay) :
         ThreadedComponent(),
         in(inStream),
         outFFT(fftStream),
         outPSD(psdStream),
-        realPsd_(NULL),
-        complexPsd_(NULL),
-        vecMean_(numAvg, psdOut_, psdAverage_),
-        eos(false),
-        paramLock(new boost::mutex()){
+        outWaterfall(waterfallStream),
+        config_(config),
+        appliedVersion_(0),
+        sriPending_(true), // force initial SRI push
+        cross_(cross),
+        crossPaired_(false),
+        trace_("psd "+in.streamID()),
+        queue_(fftStream, psdStream, waterfallStream),
+        pipeline_(config_.current().fftSz, config_.current().numAverage),
+        shmRing_(NULL),
+        lastData_(boost::get_system_time()),
+        idle_(false),
+        eos(false){
     LOG_DEBUG(PsdProcessor,__PRETTY_FUNCTION__<<" streamID="<<in.streamID());
-    params.fftSz = fftSize;
-    params.fftSzChanged = true;
-    params.strideSize=fftSize-overlap;
-    params.numAverage = numAvg;
-    params.numAverageChanged = true;
-    params.overlap = overlap;
-    params.doFFT = doFFT;
-    params.doPSD = doPSD;
-    params.rfFreqUnits = rfFreqUnits;
-    params.logCoeff = logCoeff;
-    params.updateSRI = true; // force initial SRI push
+    status_.streamID = in.streamID();
+    status_.memoryBytes = 0;
+    status_.idle = false;
+    status_.queueDepth = 0;
+    status_.droppedFrames = 0;
+    queue_.waterfall(config_.current().waterfall, config_.current().logCoeff);
     setThreadDelay(delay);
-    ThreadedComponent::startThread();
 }
 PsdProcessor::~PsdProcessor(){
     LOG_DEBUG(PsdProcessor,__PRETTY_FUNCTION__<<" streamID="<<in.streamID());
+    // send whatever is still queued before closing the streams
+    queue_.stop();
     if(!!outFFT){
         outFFT.close();
     }
     if(!!outPSD){
         outPSD.close();
     }
+    if(!!outWaterfall){
+        outWaterfall.close();
+    }
     flush();
+    if (shmRing_!=NULL)
+        delete shmRing_;
 }
 
-void PsdProcessor::updateFftSize(size_t fftSize){
+void PsdProcessor::start(){
     LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__<<" streamID="<<in.streamID());
-    boost::mutex::scoped_lock lock(*paramLock);
-    params.fftSz=fftSize;
-    params.strideSize=fftSize-params.overlap;
-    params.fftSzChanged = true;
-    params.updateSRI=true;
-}
-void PsdProcessor::updateOverlap(int overlap){
-    LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__<<" streamID="<<in.streamID());
-    boost::mutex::scoped_lock lock(*paramLock);
-    params.overlap = overlap;
-    params.strideSize=params.fftSz-overlap;
-    params.updateSRI=true;
-
-}
-void PsdProcessor::updateNumAvg(size_t avg){
-    LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__<<" streamID="<<in.streamID());
-    boost::mutex::scoped_lock lock(*paramLock);
-    params.numAverage = avg;
-    params.numAverageChanged = true;
-    params.updateSRI=true;
-}
-
-void PsdProcessor::forceSRIUpdate(){
-    LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__<<" streamID="<<in.streamID());
-    boost::mutex::scoped_lock lock(*paramLock);
-    params.updateSRI=true;
-}
-
-void PsdProcessor::updateActions(bool psd, bool fft){
-    LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__<<" psd:"<<psd<<" fft:"<<fft);
-    boost::mutex::scoped_lock lock(*paramLock);
-    params.doPSD = psd;
-    params.doFFT = fft;
-}
-
-void PsdProcessor::updateRfFreqUnits(bool enable){
-    LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__<<" new value is "<<enable);
-    boost::mutex::scoped_lock lock(*paramLock);
-    params.rfFreqUnits = enable;
-    params.updateSRI=true;
+    queue_.start();
+    ThreadedComponent::startThread();
 }
 
-void PsdProcessor::updateLogCoefficient(float logCoeff){
-    LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__<<" new value is "<<logCoeff);
-    boost::mutex::scoped_lock lock(*paramLock);
-    params.logCoeff = logCoeff;
+void PsdProcessor::updateOutputQueue(size_t depth, OutputQueue::Policy policy){
+    LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__<<" depth:"<<depth<<" policy:"<<policy);
+    // applied straight away rather than through the published settings - a
+    // processing thread blocked on a full queue has to see a policy change
+    queue_.configure(depth, policy);
 }
 
 bool PsdProcessor::finished(){
@@ -156,6 +109,17 @@ bool PsdProcessor::finished(){
     return eos;
 }
 
+stream_status_struct PsdProcessor::status(){
+    stream_status_struct status;
+    {
+        boost::mutex::scoped_lock lock(statusLock);
+        status = status_;
+    }
+    status.queueDepth = queue_.depth();
+    status.droppedFrames = queue_.dropped();
+    return status;
+}
+
 void PsdProcessor::stop() throw (CORBA::SystemException, CF::Resource::StopError){
     LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__);
     if (!ThreadedComponent::stopThread()) {
@@ -165,61 +129,162 @@ void PsdProcessor::stop() throw (CORBA::SystemException, CF::Resource::StopError
 
 void PsdProcessor::flush(){
     LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__);
-    boost::mutex::scoped_lock lock(*paramLock);
-    //delete the pointers - then on next data call when we start processing again
-    //the rest of the processing state is flushed
-    if (realPsd_!=NULL)
-        delete realPsd_;
-    if (complexPsd_!=NULL)
-        delete complexPsd_;
-
-    realPsd_ = NULL;
-    complexPsd_ = NULL;
+    pipeline_.flush();
+    ring_.clear();
 }
 
-int PsdProcessor::serviceFunction(){
+void PsdProcessor::updateShmRing(){
     LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__);
+    //only ever called from the processing thread, which owns shmRing_
+    if (shmRing_!=NULL){
+        delete shmRing_;
+        shmRing_ = NULL;
+    }
+    const PsdConfig& config = config_.current();
+    if (config.shmExport){
+        shmRing_ = new ShmRing(ShmRing::shmName(config.shmPrefix, in.streamID()), in.streamID());
+        //size for complex input so a real/complex transition never needs a bigger ring
+        if (!shmRing_->configure(config.fftSz, config.shmDepth)){
+            LOG_WARN(PsdProcessor, "Unable to create shared memory export "<<shmRing_->name()<<" for stream "<<in.streamID()<<" - the name may be in use by another instance");
+            delete shmRing_;
+            shmRing_ = NULL;
+        } else {
+            LOG_DEBUG(PsdProcessor, "Exporting psd frames to shared memory "<<shmRing_->name());
+        }
+    }
+}
 
-    // update cached copy of params
-    {
-        boost::mutex::scoped_lock lock(*paramLock);
+void PsdProcessor::checkIdle(){
+    //only ever called from the processing thread, which owns the state it frees
+    float idleTimeout = config_.current().idleTimeout;
+    if (idle_ || idleTimeout<=0)
+        return;
+    boost::posix_time::time_duration idleTime = boost::get_system_time()-lastData_;
+    if (idleTime.total_microseconds() < idleTimeout*1e6)
+        return;
+    LOG_DEBUG(PsdProcessor,"Stream "<<in.streamID()<<" idle for "<<idleTime.total_milliseconds()<<" ms - releasing processing state");
+    idle_ = true;
+    pipeline_.release();
+    ring_.release();
+    // also trims the frame pool
+    queue_.release();
+    updateStatus();
+}
+
+void PsdProcessor::applyPlacement(){
+    //only ever called from the processing thread - placement applies to the calling thread
+    const ThreadPlacement& placement = config_.current().placement;
+    if (!placement.applyAffinity())
+        LOG_WARN(PsdProcessor, "Unable to set cpu affinity for stream "<<in.streamID()<<": "<<strerror(errno));
+    if (!placement.applyPriority())
+        LOG_WARN(PsdProcessor, "Unable to set scheduling priority for stream "<<in.streamID()<<": "<<strerror(errno));
+    // the stream's own buffers may now be on another node - copy them over
+    // from here so they are first touched locally.  Scratch buffers come from
+    // the pool for whatever node the thread is on.
+    pipeline_.relocate();
+    ring_.relocate();
+}
+
+void PsdProcessor::updateStatus(){
+    //only ever called from the processing thread
+    size_t bytes = pipeline_.memoryBytes() + ring_.memoryBytes() + queue_.memoryBytes() + trace_.memoryBytes();
+    if (shmRing_)
+        bytes += shmRing_->mappedBytes();
+    if (bytes==status_.memoryBytes && idle_==status_.idle)
+        return;
+    boost::mutex::scoped_lock lock(statusLock);
+    status_.memoryBytes = bytes;
+    status_.idle = idle_;
+}
+
+void PsdProcessor::applyConfig(){
+    //only ever called from the processing thread - sets up for every group
+    //of settings published since the last call
+    const PsdConfig& config = config_.current();
 
-        // update cache
-        bool tmp = params_cache.updateSRI;
-        params_cache = params;
-        params_cache.updateSRI = params.updateSRI || tmp; // preserve flag if not addressed yet
-        // Note: we do not need to preserve the other change flags b/c they are always addressed
+    if(config.placementVersion > appliedVersion_){
+        LOG_TRACE(PsdProcessor,"serviceFunction - applying thread placement");
+        applyPlacement();
+    }
 
-        // reset global
-        params.fftSzChanged = false;
-        params.numAverageChanged = false;
-        params.updateSRI = false; // always reset to false once addressed
+    if(config.shmVersion > appliedVersion_){
+        LOG_TRACE(PsdProcessor,"serviceFunction - updating shared memory export");
+        updateShmRing();
     }
 
-    // update all data structures before processing, if needed
-    if(params_cache.fftSzChanged){
+    // before the fft size, so the new size is planned with these settings
+    if(config.transformVersion > appliedVersion_){
+        LOG_TRACE(PsdProcessor,"serviceFunction - updating transform settings");
+        pipeline_.setTransform(config.transform[0], config.transform[1]);
+    }
+
+    if(config.fftSzVersion > appliedVersion_){
         LOG_TRACE(PsdProcessor,"serviceFunction - updating data structures due to new fft size");
-        params_cache.fftSzChanged = false;
-        if (realPsd_){
-            realIn_.resize(params_cache.fftSz);
-            psdOut_.resize(params_cache.fftSz/2+1);
-            fftOut_.resize(params_cache.fftSz/2+1);
-            realPsd_->setLength(params_cache.fftSz);
-        } else if (complexPsd_) {
-            complexIn_.resize(params_cache.fftSz);
-            psdOut_.resize(params_cache.fftSz);
-            fftOut_.resize(params_cache.fftSz);
-            complexPsd_->setLength(params_cache.fftSz);
+        pipeline_.setFftSize(config.fftSz);
+        if (shmRing_ && !shmRing_->configure(config.fftSz, config.shmDepth)){
+            LOG_WARN(PsdProcessor, "Unable to resize shared memory export "<<shmRing_->name()<<" for stream "<<in.streamID());
+            delete shmRing_;
+            shmRing_ = NULL;
         }
     }
 
-    if(params_cache.numAverageChanged){
+    if(config.crossVersion > appliedVersion_){
+        LOG_TRACE(PsdProcessor,"serviceFunction - updating cross spectra pairing");
+        crossPaired_ = config.crossStreams.count(in.streamID()) > 0;
+    }
+
+    if(config.numAverageVersion > appliedVersion_){
         LOG_TRACE(PsdProcessor,"serviceFunction - updating data structures due to new num average");
-        params_cache.numAverageChanged = false;
-        vecMean_.setAvgNum(params_cache.numAverage);
+        pipeline_.setNumAvg(config.numAverage);
     }
 
-    bulkio::FloatDataBlock block = in.tryread(params_cache.fftSz,params_cache.strideSize);
+    if(config.poolingVersion > appliedVersion_){
+        LOG_TRACE(PsdProcessor,"serviceFunction - updating psd pooling");
+        pipeline_.setPooling(config.psdWidth, config.pooling);
+    }
+
+    if(config.waterfallVersion > appliedVersion_){
+        LOG_TRACE(PsdProcessor,"serviceFunction - updating waterfall coding");
+        queue_.waterfall(config.waterfall, config.logCoeff);
+    }
+
+    // kept until addressed - it may also be set by the input
+    if(config.sriVersion > appliedVersion_)
+        sriPending_ = true;
+
+    appliedVersion_ = config.version;
+}
+
+int PsdProcessor::serviceFunction(){
+    LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__);
+
+    // pick up the latest settings - valid until the next call
+    const PsdConfig& config = config_.update();
+    if (config.version != appliedVersion_)
+        applyConfig();
+
+    // with overlap only the new samples are read - the overlapped samples are
+    // still in the ring and each frame is transformed straight out of it
+    bool useRing = config.overlap > 0;
+    bulkio::FloatDataBlock block;
+    uint64_t stageStart = trace_.start(StageTrace::READ);
+    if (useRing){
+        ring_.configure(config.fftSz, config.strideSize, ring_.complex());
+        block = in.tryread(ring_.needed());
+    } else {
+        // with batching, whole frames that are already queued are read and
+        // transformed together - it never waits for more than one frame
+        size_t frames = 1;
+        size_t batch = config.transform[in.sri().mode!=0].batch;
+        if (config.overlap==0 && batch>1)
+            frames = std::min(batch, in.samplesAvailable()/config.fftSz);
+        if (frames>1)
+            block = in.tryread(frames*config.fftSz);
+        if (!block)
+            block = in.tryread(config.fftSz,config.strideSize);
+    }
+    // empty reads are not worth a trace event
+    trace_.stop(StageTrace::READ, block ? stageStart : 0);
 
     if (!block) {
         if( in.eos()){
@@ -228,10 +293,17 @@ int PsdProcessor::serviceFunction(){
             return FINISH;
         } else {
             LOG_DEBUG(PsdProcessor,"serviceFunction - got null block without EOS");
+            // nothing to work on - let a busy thread have the scratch arena
+            // and the output buffers this thread has kept
+            ScratchPool::instance().releaseThread();
+            FramePool::instance().releaseThread();
+            checkIdle();
             return NOOP;
         }
     }
     LOG_DEBUG(PsdProcessor,"serviceFunction - got block of size "<<block.size());
+    lastData_ = boost::get_system_time();
+    idle_ = false;
 
     if (block.inputQueueFlushed()) {
         LOG_WARN(PsdProcessor, "Input queue flushed.  Flushing internal buffers.");
@@ -239,98 +311,163 @@ int PsdProcessor::serviceFunction(){
         flush();
     }
 
-    // TODO - what if we got a partial block w/o fftSz worth of data?
-
-    // do work and push out data
-    if (block.complex()) {
-
-        // setup Complex
-        if (realPsd_){
-            delete realPsd_;
-            realPsd_=NULL;
-        }
-        if (complexPsd_==NULL){
-            complexPsd_ = new ComplexPsd(complexIn_, psdOut_, fftOut_, params_cache.fftSz,true);
-            vecMean_.clear();
+    // nobody wants the output - drain the input without transforming it
+    // any partial average or overlap history would be stale by the time
+    // someone connects, so that goes too
+    if (!config.doPSD && !config.doFFT && !config.doWaterfall && !shmRing_ && !crossPaired_){
+        LOG_TRACE(PsdProcessor,"serviceFunction - no consumers, dropping block");
+        if (block.sriChanged())
+            sriPending_ = true;
+        flush();
+        if (in.eos()){
+            LOG_TRACE(PsdProcessor,"serviceFunction - got EOS");
+            eos=true;
+            return FINISH;
         }
+        return NORMAL;
+    }
 
-        copyVec(block,complexIn_);
-        complexPsd_->run();
-
-    } else {
-
-        // setup Scalar
-        if (complexPsd_){
-            delete complexPsd_;
-            complexPsd_=NULL;
+    size_t blockSamples = block.complex() ? block.cxsize() : block.size();
+    BULKIO::PrecisionUTCTime frameTime = block.getTimestamps().front().time;
+    const float* frameData = block.data();
+    size_t frameSamples = blockSamples;
+    if (useRing){
+        if (block.complex() != ring_.complex())
+            ring_.configure(config.fftSz, config.strideSize, block.complex());
+        // the frame starts with whatever was already buffered
+        frameTime = frameTime - ring_.size()*block.xdelta();
+        stageStart = trace_.start(StageTrace::OVERLAP);
+        ring_.append(block.data(), blockSamples);
+        trace_.stop(StageTrace::OVERLAP, stageStart);
+        if (!ring_.full() && !in.eos()){
+            // reads stop short at sri changes - come back for the rest
+            if (block.sriChanged())
+                sriPending_ = true;
+            updateStatus();
+            return NORMAL;
         }
-        if (realPsd_==NULL){
-            realPsd_ = new RealPsd(realIn_, psdOut_, fftOut_, params_cache.fftSz,true);
-            vecMean_.clear();
+        frameData = ring_.window();
+        frameSamples = ring_.size();
+    }
+
+    // do work and push out data
+    // the outputs are computed straight into the frames that are sent, so
+    // nothing is copied on the way out
+    // partial frames (at EOS) are zero padded by the pipeline
+    //
+    // a batched read holds whole frames back to back, and possibly a short
+    // last frame (at EOS or an sri change) that is transformed on its own.
+    // The batch's fft frames are slices of one buffer
+    //
+    // the fft is kept for the cross spectra as well as the fft output
+    bool keepFft = config.doFFT || crossPaired_;
+    size_t batched = frameSamples>config.fftSz ? frameSamples/config.fftSz : 0;
+    size_t frames = batched ? (frameSamples+config.fftSz-1)/config.fftSz : 1;
+    size_t floatsPerFrame = block.complex() ? 2*config.fftSz : config.fftSz;
+    size_t fftBins = pipeline_.fftBins(block.complex());
+    redhawk::buffer<std::complex<float> > fftBatch;
+    for (size_t frame=0; frame<frames; frame++){
+        redhawk::buffer<std::complex<float> > fftFrame;
+        stageStart = trace_.start(StageTrace::FFT);
+        if (frame<batched){
+            if (frame==0){
+                if (keepFft)
+                    fftBatch = FramePool::instance().lease<std::complex<float> >(batched*fftBins);
+                pipeline_.run(frameData, batched*config.fftSz, block.complex(), fftBatch.data(), batched);
+            } else {
+                pipeline_.selectFrame(frame);
+            }
+            if (keepFft)
+                fftFrame = fftBatch.slice(frame*fftBins, (frame+1)*fftBins);
+        } else {
+            if (keepFft)
+                fftFrame = FramePool::instance().lease<std::complex<float> >(fftBins);
+            pipeline_.run(frameData+frame*floatsPerFrame, frameSamples-frame*config.fftSz,
+                          block.complex(), fftFrame.data());
         }
+        trace_.stop(StageTrace::FFT, stageStart);
+        outputFrame(block, frame==0 && block.sriChanged(), fftFrame,
+                    frameTime+frame*config.fftSz*block.xdelta());
+    }
+    if (useRing)
+        ring_.advance();
+    pipeline_.done();
+    updateStatus();
 
-        copyVec(block,realIn_);
-        realPsd_->run();
+    if (in.eos()){
+        LOG_TRACE(PsdProcessor,"serviceFunction - got EOS");
+        eos=true;
+        return FINISH;
     }
 
+    return NORMAL;
+}
+
+void PsdProcessor::outputFrame(const bulkio::FloatDataBlock& block, bool sriChanged,
+                               const redhawk::buffer<std::complex<float> >& fftFrame,
+                               const BULKIO::PrecisionUTCTime& frameTime){
+    //the psd, fft shift and output of the frame the pipeline has selected
+    const PsdConfig& config = config_.current();
+    uint64_t stageStart;
+    redhawk::buffer<float> psdFrame;
     float* psdOutPtr = NULL;
     size_t psdOutLen = 0;
-    if (params_cache.doPSD){
-        if (params_cache.numAverage > 1){
-            if (vecMean_.run()){
-                psdOutPtr = &psdAverage_[0];
-                psdOutLen = psdAverage_.size();
-            }
-        } else {
-            psdOutPtr = &psdOut_[0];
-            psdOutLen = psdOut_.size();
-        }
-        //take the log of the output if necessary
-        if (params_cache.logCoeff > 0){
-            for (size_t i=0;i<psdOutLen;i++){
-                psdOutPtr[i]=params_cache.logCoeff*log10(psdOutPtr[i]);
-            }
-        }
+    if (config.doPSD || config.doWaterfall || shmRing_){
+        // the shared memory export copies the psd out, so on its own it needs
+        // no frame - the magnitudes then go straight over the fft output.
+        // While averaging only the frame that completes the mean needs one
+        if ((config.doPSD || config.doWaterfall) && pipeline_.psdDue())
+            psdFrame = FramePool::instance().lease<float>(pipeline_.fftBins(block.complex()));
+        stageStart = trace_.start(StageTrace::PSD);
+        pipeline_.psd(config.logCoeff, psdOutPtr, psdOutLen, !fftFrame.empty(), psdFrame.data());
+        trace_.stop(StageTrace::PSD, stageStart);
     }
 
-    std::complex<float>* fftOutPtr = NULL;
-    size_t fftOutLen = 0;
-    if (params_cache.doFFT){
-        fftOutPtr = &fftOut_[0];
-        fftOutLen = fftOut_.size();
+    if (!fftFrame.empty()){
+        stageStart = trace_.start(StageTrace::FFT_SHIFT);
+        size_t fftOutLen;
+        pipeline_.fft(fftOutLen);
+        trace_.stop(StageTrace::FFT_SHIFT, stageStart);
     }
 
     // Update SRI
-    if (params_cache.updateSRI || block.sriChanged()) {
-        params_cache.updateSRI = false; // always reset to false once addressed
+    if (sriPending_ || sriChanged) {
+        sriPending_ = false; // always reset to false once addressed
+        stageStart = trace_.start(StageTrace::SRI);
         updateSRI(block);
+        trace_.stop(StageTrace::SRI, stageStart);
     }
 
     //output data
-    // NOTE - getTimeStamps() returns sorted list.
+    // NOTE - frameTime comes from getTimeStamps(), which returns a sorted list.
     //        First is guaranteed to be offset 0, and may or may not be synthetic.
     //        If any others, they will be non-synthetic.
     // TODO - should adjust Timestamp for extra sample delay from elements in last loop
-    if (psdOutLen>0){
-        // we can assume params_cache.doPSD=true and psdOutPtr!=NULL if psdOutLen>0
-        outPSD.write(psdOutPtr, psdOutLen, block.getTimestamps().front().time);
-    }
-    if (fftOutLen>0){
-        // we can assume params_cache.doFFT=true and fftOutPtr!=NULL if fftOutLen>0
-        outFFT.write(fftOutPtr, fftOutLen, block.getTimestamps().front().time);
-    }
-
-    if (in.eos()){
-        LOG_TRACE(PsdProcessor,"serviceFunction - got EOS");
-        eos=true;
-        return FINISH;
+    // the bulkio writes are done by the queue's sender thread
+    if (psdOutLen>0 && shmRing_){
+        // we can assume psdOutPtr!=NULL if psdOutLen>0
+        stageStart = trace_.start(StageTrace::SHM);
+        shmRing_->publishFrame(psdOutPtr, psdOutLen, frameTime);
+        trace_.stop(StageTrace::SHM, stageStart);
     }
-
-    return NORMAL;
+    // the waterfall is encoded by the sender, off this thread
+    // pooling leaves the psd at the start of its frame
+    if (psdOutLen>0)
+        psdFrame = psdFrame.slice(0, psdOutLen);
+    else
+        psdFrame = redhawk::buffer<float>();
+    // the cross spectra share the shifted fft frame with the fft output
+    if (crossPaired_ && fftSRI_ && !fftFrame.empty())
+        cross_.push(in.streamID(), fftFrame, frameTime, fftSRI_, block.xdelta());
+    stageStart = trace_.start(StageTrace::QUEUE);
+    queue_.push(psdFrame, config.doFFT ? fftFrame : redhawk::buffer<std::complex<float> >(),
+                frameTime, config.doPSD, config.doWaterfall);
+    trace_.stop(StageTrace::QUEUE, stageStart);
 }
 
 void PsdProcessor::updateSRI(const bulkio::FloatDataBlock &block){
     LOG_TRACE(PsdProcessor,__PRETTY_FUNCTION__);
+    const PsdConfig& config = config_.current();
 
     // example of how to use sriChangeFlags
     if (block.sriChangeFlags() & bulkio::sri::XDELTA) {
@@ -349,14 +486,14 @@ void PsdProcessor::updateSRI(const bulkio::FloatDataBlock &block){
     }
 
     double xdelta_in = block.xdelta();
-    outputSRI.xdelta = 1.0/(xdelta_in*params_cache.fftSz);
+    outputSRI.xdelta = 1.0/(xdelta_in*config.fftSz);
 
     double ifStart = 0;
     if (block.complex()) //complex Data
-        ifStart = -((params_cache.fftSz/2-1)*outputSRI.xdelta);
+        ifStart = -((config.fftSz/2-1)*outputSRI.xdelta);
 
     //adjust the xstart for RF units if required
-    if (params_cache.rfFreqUnits){
+    if (config.rfFreqUnits){
         const redhawk::PropertyMap& props = redhawk::PropertyMap::cast(block.sri().keywords);
         long rfCenter;
         bool validRF = false;
@@ -382,23 +519,37 @@ void PsdProcessor::updateSRI(const bulkio::FloatDataBlock &block){
     }
 
     if (!block.complex())
-        outputSRI.subsize = params_cache.fftSz/2+1;
+        outputSRI.subsize = config.fftSz/2+1;
     else
-        outputSRI.subsize =params_cache.fftSz;
-    outputSRI.ydelta = xdelta_in*params_cache.strideSize;
+        outputSRI.subsize =config.fftSz;
+    outputSRI.ydelta = xdelta_in*config.strideSize;
     outputSRI.yunits = BULKIO::UNITS_TIME;
     outputSRI.xunits = BULKIO::UNITS_FREQUENCY;
     outputSRI.mode = 1; //data is always complex out of the fft
 
-    // set/update the sri for the output FFT stream
-    outFFT.sri(outputSRI);
+    // sri for the output FFT stream
+    BULKIO::StreamSRI fftSRI = outputSRI;
 
-    if (params_cache.numAverage > 2)
-        outputSRI.ydelta*=params_cache.numAverage;
+    if (config.numAverage > 2)
+        outputSRI.ydelta*=config.numAverage;
 
-    // set/update the sri for the output PSD stream
+    // sri for the output PSD stream
     outputSRI.mode = 0; //data is always real out of the psd
-    outPSD.sri(outputSRI);
+
+    // pooled bins are wider - xstart moves to the centre of the first one
+    size_t psdBins = pipeline_.psdSize(outputSRI.subsize);
+    if (psdBins != size_t(outputSRI.subsize)) {
+        double binsPerBin = double(outputSRI.subsize)/psdBins;
+        outputSRI.xstart += outputSRI.xdelta*(binsPerBin-1)/2;
+        outputSRI.xdelta *= binsPerBin;
+        outputSRI.subsize = psdBins;
+    }
+
+    // the streams are updated in order with the queued frames
+    queue_.sri(fftSRI, outputSRI);
+    fftSRI_.reset(new BULKIO::StreamSRI(fftSRI));
+    if (shmRing_)
+        shmRing_->publishSRI(outputSRI);
 
 }
 
@@ -411,12 +562,20 @@ void PsdProcessor::updateSRI(const bulkio::FloatDataBlock &block){
  ****************************************************************/
 psd_i::psd_i(const char *uuid, const char *label) :
    psd_base(uuid, label),
+   crossSpectra(csd_dataFloat_out),
    doPSD(false),
    doFFT(false),
+   doWaterfall(false),
+   doCrossSpectra(false),
+   waterfallConnects(0),
+   lockFailures(0),
+   lockWarned(false),
    listener(*this, &psd_i::callBackFunc)
 {
     psd_dataFloat_out->setNewConnectListener(&listener);
     fft_dataFloat_out->setNewConnectListener(&listener);
+    waterfall_dataOctet_out->setNewConnectListener(&listener);
+    csd_dataFloat_out->setNewConnectListener(&listener);
 }
 
 psd_i::~psd_i()
@@ -434,6 +593,30 @@ void psd_i::constructor()
     addPropertyListener(numAvg, this, &psd_i::numAvgChanged);
     addPropertyListener(rfFreqUnits, this, &psd_i::rfFreqUnitsChanged);
     addPropertyListener(logCoefficient, this, &psd_i::logCoeffChanged);
+    addPropertyListener(psdWidth, this, &psd_i::psdWidthChanged);
+    addPropertyListener(psdPooling, this, &psd_i::psdPoolingChanged);
+    addPropertyListener(waterfallResolution, this, &psd_i::waterfallResolutionChanged);
+    addPropertyListener(waterfallKeyframeInterval, this, &psd_i::waterfallKeyframeIntervalChanged);
+    addPropertyListener(shmExport, this, &psd_i::shmExportChanged);
+    addPropertyListener(shmPrefix, this, &psd_i::shmPrefixChanged);
+    addPropertyListener(shmDepth, this, &psd_i::shmDepthChanged);
+    addPropertyListener(idleTimeout, this, &psd_i::idleTimeoutChanged);
+    addPropertyListener(outputQueueDepth, this, &psd_i::outputQueueDepthChanged);
+    addPropertyListener(outputQueuePolicy, this, &psd_i::outputQueuePolicyChanged);
+    addPropertyListener(cpuAffinity, this, &psd_i::cpuAffinityChanged);
+    addPropertyListener(realtimePriority, this, &psd_i::realtimePriorityChanged);
+    addPropertyListener(lockMemory, this, &psd_i::lockMemoryChanged);
+    addPropertyListener(traceEnabled, this, &psd_i::traceEnabledChanged);
+    addPropertyListener(traceFile, this, &psd_i::traceFileChanged);
+    addPropertyListener(autotune, this, &psd_i::autotuneChanged);
+    addPropertyListener(crossSpectrumPairs, this, &psd_i::crossSpectrumPairsChanged);
+    addPropertyListener(crossSpectrumAvg, this, &psd_i::crossSpectrumAvgChanged);
+    ScratchPool::instance().setLockMemory(lockMemory);
+    FramePool::instance().setLockMemory(lockMemory);
+    StageTrace::setEnabled(traceEnabled);
+    tuneTransform();
+    updateCrossSpectra();
+    publishConfig();
 
     dataFloat_in->addStreamListener(this, &psd_i::streamAdded);
 }
@@ -574,6 +757,7 @@ int psd_i::serviceFunction()
 
     // clean up finished threads
     int retval = NOOP;
+    std::vector<stream_status_struct> status;
     {
         boost::mutex::scoped_lock lock(stateMapLock);
         for(map_type::iterator i = stateMap.begin();i!=stateMap.end();){
@@ -582,11 +766,36 @@ int psd_i::serviceFunction()
                 stateMap.erase(i++);
                 retval = NORMAL;
             } else {
+                status.push_back(i->second->status());
                 ++i;
             }
         }
     }
 
+    // refresh the status properties
+    {
+        boost::mutex::scoped_lock lock(propertySetAccess);
+        streamStatus.swap(status);
+        scratchMemory = ScratchPool::instance().bytes();
+        outputBufferMemory = FramePool::instance().bytes();
+        outputBufferAllocations = FramePool::instance().allocated();
+    }
+
+    // settings snapshots the processors have all moved past
+    configPublisher.reclaim();
+    // scratch arenas no stream has needed since the last pass
+    ScratchPool::instance().trim();
+
+    size_t failures = ScratchPool::instance().lockFailures() + FramePool::instance().lockFailures();
+    if (failures != lockFailures) {
+        boost::mutex::scoped_lock lock(propertySetAccess);
+        if (!lockWarned) {
+            LOG_WARN(psd_i, "Unable to lock scratch and output memory - check RLIMIT_MEMLOCK");
+            lockWarned = true;
+        }
+        lockFailures = failures;
+    }
+
     return retval;
 }
 
@@ -597,9 +806,11 @@ void psd_i::streamAdded(bulkio::InFloatStream stream){
         LOG_DEBUG(psd_i,"Adding new thread processor: "<<stream.streamID());
         bulkio::OutFloatStream outputFFT = fft_dataFloat_out->createStream(stream.streamID());
         bulkio::OutFloatStream outputPSD = psd_dataFloat_out->createStream(stream.streamID());
+        bulkio::OutOctetStream outputWaterfall = waterfall_dataOctet_out->createStream(stream.streamID());
         boost::shared_ptr<PsdProcessor> newThread(
-                new PsdProcessor(stream, outputFFT, outputPSD, fftSize, overlap, numAvg,
-                        logCoefficient, doFFT, doPSD, rfFreqUnits));
+                new PsdProcessor(stream, outputFFT, outputPSD, outputWaterfall, configPublisher, crossSpectra));
+        newThread->updateOutputQueue(outputQueueDepth, queuePolicy());
+        newThread->start();
         map_type::value_type newEntry(stream.streamID(),newThread);
         stateMap.insert(stateMap.end(),newEntry);
     } else {
@@ -627,47 +838,33 @@ void psd_i::clearThreads(){
 void psd_i::fftSizeChanged(unsigned int oldValue, unsigned int newValue){
     LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
     if (oldValue != newValue) {
-        boost::mutex::scoped_lock lock(stateMapLock);
-        for (map_type::iterator i = stateMap.begin(); i!=stateMap.end(); i++) {
-            i->second->updateFftSize(fftSize);
-        }
+        tuneTransform();
+        publishConfig();
     }
 }
 
 void psd_i::numAvgChanged(unsigned int oldValue, unsigned int newValue){
     LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
-    if (oldValue != newValue) {
-        boost::mutex::scoped_lock lock(stateMapLock);
-        for (map_type::iterator i = stateMap.begin(); i!=stateMap.end(); i++)
-            i->second->updateNumAvg(numAvg);
-    }
+    if (oldValue != newValue)
+        publishConfig();
 }
 
 void psd_i::overlapChanged(int oldValue, int newValue){
     LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
-    if (oldValue != newValue) {
-        boost::mutex::scoped_lock lock(stateMapLock);
-        for (map_type::iterator i = stateMap.begin(); i!=stateMap.end(); i++)
-            i->second->updateOverlap(overlap);
-    }
+    if (oldValue != newValue)
+        publishConfig();
 }
 
 void psd_i::rfFreqUnitsChanged(bool oldValue, bool newValue){
     LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
-    if (oldValue != newValue) {
-        boost::mutex::scoped_lock lock(stateMapLock);
-        for (map_type::iterator i = stateMap.begin(); i!=stateMap.end(); i++)
-            i->second->updateRfFreqUnits(rfFreqUnits);
-    }
+    if (oldValue != newValue)
+        publishConfig();
 }
 
 void psd_i::logCoeffChanged(float oldValue, float newValue){
     LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
-    if (oldValue != newValue) {
-        boost::mutex::scoped_lock lock(stateMapLock);
-        for (map_type::iterator i = stateMap.begin(); i!=stateMap.end(); i++)
-            i->second->updateLogCoefficient(logCoefficient);
-    }
+    if (oldValue != newValue)
+        publishConfig();
 }
 
 void psd_i::callBackFunc( const char* connectionId){
@@ -681,9 +878,269 @@ void psd_i::callBackFunc( const char* connectionId){
         doFFT = !doFFT;
         doUpdate = true;
     }
-    if(doUpdate){
+    if(doWaterfall != (waterfall_dataOctet_out->state()!=BULKIO::IDLE)){
+        doWaterfall = !doWaterfall;
+        doUpdate = true;
+    }
+    if(doCrossSpectra != (csd_dataFloat_out->state()!=BULKIO::IDLE)){
+        doCrossSpectra = !doCrossSpectra;
+        doUpdate = true;
+    }
+    // the waterfall may already be running for another consumer, and a new
+    // one can only start decoding on a keyframe.  The listener does not say
+    // which port was connected, so any connection forces one
+    if(doWaterfall){
+        waterfallConnects++;
+        doUpdate = true;
+    }
+    if(doUpdate)
+        publishConfig();
+}
+
+void psd_i::shmExportChanged(bool oldValue, bool newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        publishConfig();
+}
+
+void psd_i::shmPrefixChanged(const std::string& oldValue, const std::string& newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue && shmExport)
+        publishConfig();
+}
+
+void psd_i::shmDepthChanged(unsigned int oldValue, unsigned int newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue && shmExport)
+        publishConfig();
+}
+
+void psd_i::idleTimeoutChanged(float oldValue, float newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        publishConfig();
+}
+
+void psd_i::psdWidthChanged(unsigned int oldValue, unsigned int newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        publishConfig();
+}
+
+void psd_i::psdPoolingChanged(const std::string& oldValue, const std::string& newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        publishConfig();
+}
+
+void psd_i::waterfallResolutionChanged(float oldValue, float newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        publishConfig();
+}
+
+void psd_i::waterfallKeyframeIntervalChanged(unsigned int oldValue, unsigned int newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        publishConfig();
+}
+
+PsdPipeline::Pooling psd_i::pooling(){
+    PsdPipeline::Pooling pooling = PsdPipeline::POOL_MEAN;
+    if (!PsdPipeline::parsePooling(psdPooling, pooling))
+        LOG_WARN(psd_i, "Unknown psdPooling "<<psdPooling<<" - using mean");
+    return pooling;
+}
+
+OutputQueue::Policy psd_i::queuePolicy(){
+    OutputQueue::Policy policy = OutputQueue::BLOCK;
+    if (!OutputQueue::parsePolicy(outputQueuePolicy, policy))
+        LOG_WARN(psd_i, "Unknown outputQueuePolicy "<<outputQueuePolicy<<" - using block");
+    return policy;
+}
+
+void psd_i::outputQueueDepthChanged(unsigned int oldValue, unsigned int newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue) {
+        OutputQueue::Policy policy = queuePolicy();
+        boost::mutex::scoped_lock lock(stateMapLock);
+        for (map_type::iterator i = stateMap.begin(); i!=stateMap.end(); i++)
+            i->second->updateOutputQueue(outputQueueDepth, policy);
+    }
+}
+
+void psd_i::outputQueuePolicyChanged(const std::string& oldValue, const std::string& newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue) {
+        OutputQueue::Policy policy = queuePolicy();
         boost::mutex::scoped_lock lock(stateMapLock);
         for (map_type::iterator i = stateMap.begin(); i!=stateMap.end(); i++)
-            i->second->updateActions(doPSD, doFFT);
+            i->second->updateOutputQueue(outputQueueDepth, policy);
+    }
+}
+
+ThreadPlacement psd_i::placement(){
+    ThreadPlacement placement;
+    if (!placement.setCpus(cpuAffinity)) {
+        LOG_WARN(psd_i, "Invalid cpuAffinity '"<<cpuAffinity<<"' - processing threads are not pinned");
+        placement.setCpus("");
+    }
+    if (realtimePriority < 0 || realtimePriority > 99) {
+        LOG_WARN(psd_i, "realtimePriority must be 0-99 - using normal scheduling");
+    } else {
+        placement.setPriority(realtimePriority);
+    }
+    return placement;
+}
+
+void psd_i::publishConfig(){
+    PsdConfig config;
+    config.fftSz = fftSize;
+    config.overlap = overlap;
+    // every frame has to take in at least one new sample
+    if (fftSize > 0 && overlap >= int(fftSize)) {
+        config.overlap = fftSize-1;
+        LOG_WARN(psd_i, "overlap must be less than fftSize - using "<<config.overlap);
+    }
+    config.strideSize = fftSize-config.overlap;
+    config.numAverage = numAvg;
+    config.doFFT = doFFT;
+    config.doPSD = doPSD;
+    config.doWaterfall = doWaterfall;
+    config.rfFreqUnits = rfFreqUnits;
+    config.logCoeff = logCoefficient;
+    config.psdWidth = psdWidth;
+    config.pooling = pooling();
+    if (waterfallResolution > 0) {
+        config.waterfall.resolution = waterfallResolution;
+    } else {
+        LOG_WARN(psd_i, "waterfallResolution must be positive - using "<<config.waterfall.resolution<<" dB");
+    }
+    config.waterfall.keyframeInterval = waterfallKeyframeInterval;
+    config.transform[0] = transformSettings[0];
+    config.transform[1] = transformSettings[1];
+    if (doCrossSpectra)
+        config.crossStreams = crossSpectra.streams();
+    config.shmExport = shmExport;
+    config.shmPrefix = shmPrefix;
+    config.shmDepth = shmDepth;
+    config.idleTimeout = idleTimeout;
+    config.cpuAffinity = cpuAffinity;
+    config.realtimePriority = realtimePriority;
+    config.placement = placement();
+    config.waterfallConnects = waterfallConnects;
+    // no processor is stopped - each picks this up on its next call
+    configPublisher.publish(config);
+}
+
+void psd_i::autotuneChanged(bool oldValue, bool newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue) {
+        tuneTransform();
+        publishConfig();
+    }
+}
+
+void psd_i::tuneTransform(){
+    // runs in the property callback - the configure waits for the search.
+    // Streams may be real or complex, which plan differently, so both are
+    // tuned with half of the budget each
+    if (autotune && autotuneBudget <= 0)
+        LOG_WARN(psd_i, "autotuneBudget must be positive - only cached choices are used");
+    Autotuner tuner(autotuneCache);
+    transformConfig.clear();
+    for (int complex=0; complex<2; complex++) {
+        const char* mode = complex ? "complex" : "real";
+        Autotuner::Result result;
+        if (autotune && fftSize > 0) {
+            result = tuner.tune(fftSize, complex, std::max(autotuneBudget, 0.0f)/2);
+            LOG_DEBUG(psd_i, "fftSize "<<fftSize<<" "<<mode<<": "<<TransformSettings::rigorName(result.settings.rigor)
+                      <<" planning, "<<result.settings.threads<<" threads, batches of "<<result.settings.batch
+                      <<" - "<<result.nsPerFrame<<" ns per frame"<<(result.cached ? " (cached)" : ""));
+        }
+        transformSettings[complex] = result.settings;
+        transform_config_struct config;
+        config.mode = mode;
+        config.planRigor = TransformSettings::rigorName(result.settings.rigor);
+        config.fftwThreads = result.settings.threads;
+        config.batchFrames = result.settings.batch;
+        config.nsPerFrame = result.nsPerFrame;
+        if (result.cached)
+            config.source = "cached";
+        else if (result.nsPerFrame > 0)
+            config.source = "autotuned";
+        else
+            config.source = "default";
+        transformConfig.push_back(config);
+    }
+}
+
+void psd_i::crossSpectrumPairsChanged(const std::vector<cross_spectrum_pair_struct>& oldValue,
+                                      const std::vector<cross_spectrum_pair_struct>& newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue) {
+        updateCrossSpectra();
+        publishConfig();
+    }
+}
+
+void psd_i::crossSpectrumAvgChanged(unsigned int oldValue, unsigned int newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        updateCrossSpectra();
+}
+
+void psd_i::updateCrossSpectra(){
+    std::vector<CrossSpectra::Pair> pairs;
+    for (size_t i=0; i<crossSpectrumPairs.size(); i++) {
+        const cross_spectrum_pair_struct& pair = crossSpectrumPairs[i];
+        if (pair.streamA.empty() || pair.streamB.empty() || pair.streamA == pair.streamB) {
+            LOG_WARN(psd_i, "Ignoring cross spectrum pair '"<<pair.streamA<<"', '"<<pair.streamB<<"' - needs two different stream IDs");
+            continue;
+        }
+        pairs.push_back(CrossSpectra::Pair(pair.streamA, pair.streamB));
+    }
+    if (crossSpectrumAvg == 0)
+        LOG_WARN(psd_i, "crossSpectrumAvg must be at least 1 - using 1");
+    crossSpectra.configure(pairs, crossSpectrumAvg);
+}
+
+void psd_i::cpuAffinityChanged(const std::string& oldValue, const std::string& newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        publishConfig();
+}
+
+void psd_i::realtimePriorityChanged(int oldValue, int newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue)
+        publishConfig();
+}
+
+void psd_i::lockMemoryChanged(bool oldValue, bool newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    if (oldValue != newValue) {
+        ScratchPool::instance().setLockMemory(lockMemory);
+        FramePool::instance().setLockMemory(lockMemory);
+        // warn again if the new setting fails too
+        lockWarned = false;
+    }
+}
+
+void psd_i::traceEnabledChanged(bool oldValue, bool newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    StageTrace::setEnabled(traceEnabled);
+}
+
+void psd_i::traceFileChanged(const std::string& oldValue, const std::string& newValue){
+    LOG_TRACE(psd_i,__PRETTY_FUNCTION__);
+    // only called when the path changes - setting the same path again writes
+    // nothing, so clear it first to refresh the same file
+    if (traceFile.empty())
+        return;
+    if (StageTrace::dump(traceFile)) {
+        LOG_DEBUG(psd_i, "Wrote stage trace to "<<traceFile);
+    } else {
+        LOG_WARN(psd_i, "Unable to write stage trace to "<<traceFile<<": "<<strerror(errno));
     }
 }
@@ -20,24 +20,18 @@
 #define PSD_IMPL_H
 
 #include "psd_base.h"
-#include "fft.h"
+#include <boost/thread/thread_time.hpp>
+#include "autotune.h"
+#include "config.h"
+#include "crossspectra.h"
 #include "framebuffer.h"
-#include "vectormean.h"
-
-
-typedef struct ParamStruct {
-    size_t fftSz;
-    bool fftSzChanged;
-    size_t strideSize;
-    size_t numAverage;
-    bool numAverageChanged;
-    int overlap;
-    bool doFFT;
-    bool doPSD;
-    bool rfFreqUnits;
-    float logCoeff;
-    bool updateSRI;
-} param_struct;
+#include "framepool.h"
+#include "outputqueue.h"
+#include "pipeline.h"
+#include "placement.h"
+#include "samplering.h"
+#include "shmring.h"
+#include "trace.h"
 
 
 class PsdProcessor : protected ThreadedComponent
@@ -51,48 +45,68 @@ class PsdProcessor : protected ThreadedComponent
     //this class does both fft,psd, or both (or neither) as requested at processing time
 public:
     PsdProcessor(bulkio::InFloatStream inStream, bulkio::OutFloatStream fftStream, bulkio::OutFloatStream psdStream,
-            size_t fftSize, int overlap, size_t numAvg,    float logCoeff,    bool doFFT,    bool doPSD,    bool rfFreqUnits, float delay=0.1);
+            bulkio::OutOctetStream waterfallStream, ConfigPublisher& config, CrossSpectra& cross,
+            float delay=0.1);
     ~PsdProcessor();
 
-    void updateFftSize(size_t fftSize);
-    void updateOverlap(int overlap);
-    void updateNumAvg(size_t avg);
-    void updateRfFreqUnits(bool enable);
-    void updateLogCoefficient(float logCoeff);
-    void updateActions(bool psd, bool fft);
-    void forceSRIUpdate();
+    void start();
+    void updateOutputQueue(size_t depth, OutputQueue::Policy policy);
     bool finished();
+    stream_status_struct status();
     void stop() throw (CF::Resource::StopError, CORBA::SystemException);
 
 private:
     int serviceFunction();
+    void applyConfig();
+    void outputFrame(const bulkio::FloatDataBlock& block, bool sriChanged,
+                     const redhawk::buffer<std::complex<float> >& fftFrame,
+                     const BULKIO::PrecisionUTCTime& frameTime);
     void updateSRI(const bulkio::FloatDataBlock &block);
     void flush();
+    void updateShmRing();
+    void checkIdle();
+    void applyPlacement();
+    void updateStatus();
 
     // in/out streams
     bulkio::InFloatStream in;
     bulkio::OutFloatStream outFFT;
     bulkio::OutFloatStream outPSD;
+    bulkio::OutOctetStream outWaterfall;
+
+    // published settings, and the version the state below was last set up for
+    ConfigReader config_;
+    unsigned long appliedVersion_;
+    bool sriPending_;
+
+    // cross spectra this stream's fft frames go to, when it is in a pair
+    CrossSpectra& cross_;
+    bool crossPaired_;
+    CrossSpectra::SRIPtr fftSRI_;
+
+    // stage timing for this thread
+    StageTrace trace_;
 
-    // PSD processing object ptrs
-    RealPsd* realPsd_;
-    ComplexPsd* complexPsd_;
+    // frames waiting for the output streams
+    OutputQueue queue_;
 
-    //internal processing vectors
-    RealFFTWVector realIn_;
-    ComplexFFTWVector complexIn_;
-    ComplexFFTWVector fftOut_;
-    RealFFTWVector psdOut_;
+    // fft/psd/averaging state
+    PsdPipeline pipeline_;
 
-    // for psd averaging
-    VectorMean<float, fftwf_allocator<float> > vecMean_;
-    std::vector<float> psdAverage_;
+    // input history when frames overlap
+    SampleRing ring_;
 
-    // parameters and status
+    // optional /dev/shm export of the psd frames
+    ShmRing* shmRing_;
+
+    // when the stream last had data - after idleTimeout the state above is freed
+    boost::system_time lastData_;
+    bool idle_;
+
+    // status
     bool eos;
-    param_struct params;
-    param_struct params_cache;
-    boost::shared_ptr<boost::mutex> paramLock;
+    stream_status_struct status_;
+    boost::mutex statusLock;
 };
 
 class psd_i : public psd_base
@@ -111,14 +125,56 @@ class psd_i : public psd_base
         void overlapChanged(int oldValue, int newValue);
         void rfFreqUnitsChanged(bool oldValue, bool newValue);
         void logCoeffChanged(float oldValue, float newValue);
+        void psdWidthChanged(unsigned int oldValue, unsigned int newValue);
+        void psdPoolingChanged(const std::string& oldValue, const std::string& newValue);
+        PsdPipeline::Pooling pooling();
+        void waterfallResolutionChanged(float oldValue, float newValue);
+        void waterfallKeyframeIntervalChanged(unsigned int oldValue, unsigned int newValue);
+        void shmExportChanged(bool oldValue, bool newValue);
+        void shmPrefixChanged(const std::string& oldValue, const std::string& newValue);
+        void shmDepthChanged(unsigned int oldValue, unsigned int newValue);
+        void idleTimeoutChanged(float oldValue, float newValue);
+        void outputQueueDepthChanged(unsigned int oldValue, unsigned int newValue);
+        void outputQueuePolicyChanged(const std::string& oldValue, const std::string& newValue);
+        OutputQueue::Policy queuePolicy();
+        void cpuAffinityChanged(const std::string& oldValue, const std::string& newValue);
+        void realtimePriorityChanged(int oldValue, int newValue);
+        void lockMemoryChanged(bool oldValue, bool newValue);
+        void traceEnabledChanged(bool oldValue, bool newValue);
+        void traceFileChanged(const std::string& oldValue, const std::string& newValue);
+        void crossSpectrumPairsChanged(const std::vector<cross_spectrum_pair_struct>& oldValue,
+                                       const std::vector<cross_spectrum_pair_struct>& newValue);
+        void crossSpectrumAvgChanged(unsigned int oldValue, unsigned int newValue);
+        void updateCrossSpectra();
+        void autotuneChanged(bool oldValue, bool newValue);
+        void tuneTransform();
+        ThreadPlacement placement();
+        void publishConfig();
         void clearThreads();
 
+        // settings for the processors - declared before them so it outlives them
+        ConfigPublisher configPublisher;
+        CrossSpectra crossSpectra;
+
         typedef std::map<std::string, boost::shared_ptr<PsdProcessor> > map_type;
         map_type stateMap;
         boost::mutex stateMapLock;
 
+        // fft plan settings for fftSize - the defaults or the autotuner's choice
+        // [0] for real input, [1] for complex
+        TransformSettings transformSettings[2];
+
         bool doPSD;
         bool doFFT;
+        bool doWaterfall;
+        bool doCrossSpectra;
+        // connections made while the waterfall was connected
+        unsigned long waterfallConnects;
+
+        // last ScratchPool and FramePool lockFailures() seen, and whether
+        // they have been warned about since lockMemory was last set
+        size_t lockFailures;
+        bool lockWarned;
 
         bulkio::MemberConnectionEventListener<psd_i> listener;
         void callBackFunc( const char* connectionId);
@@ -40,6 +40,10 @@ psd_base::psd_base(const char *uuid, const char *label) :
     addPort("psd_dataFloat_out", "Float output port for power spectral density. The output will be two dimentional data with a subsize of half the FFT size plus one for real input data and equal to the FFT size for complex input data. The PSD output data is always scalar.  ", psd_dataFloat_out);
     fft_dataFloat_out = new bulkio::OutFloatPort("fft_dataFloat_out");
     addPort("fft_dataFloat_out", "Float output port for the FFT of the input data. The output will be two dimentional data with a subsize of half the FFT size plus one for real input data and equal to the FFT size for complex input data. The FFT output data is always complex.  ", fft_dataFloat_out);
+    waterfall_dataOctet_out = new bulkio::OutOctetPort("waterfall_dataOctet_out");
+    addPort("waterfall_dataOctet_out", "Octet output port for the compressed psd waterfall.  Each packet is one psd frame quantized to waterfallResolution dB and coded against the previous frame, with a keyframe every waterfallKeyframeInterval frames.  The packet format is described in waterfallcodec.h.  Only computed while connected.", waterfall_dataOctet_out);
+    csd_dataFloat_out = new bulkio::OutFloatPort("csd_dataFloat_out");
+    addPort("csd_dataFloat_out", "Float output port for the averaged cross spectral density and coherence of each pair in crossSpectrumPairs.  Each pair has a complex csd:<streamA>:<streamB> stream and a real coherence:<streamA>:<streamB> stream, framed like the fft output of streamA.  Only computed while connected.", csd_dataFloat_out);
 }
 
 psd_base::~psd_base()
@@ -50,6 +54,10 @@ psd_base::~psd_base()
     psd_dataFloat_out = 0;
     delete fft_dataFloat_out;
     fft_dataFloat_out = 0;
+    delete waterfall_dataOctet_out;
+    waterfall_dataOctet_out = 0;
+    delete csd_dataFloat_out;
+    csd_dataFloat_out = 0;
 }
 
 /*******************************************************************************************
@@ -120,6 +128,51 @@ void psd_base::loadProperties()
                 "external",
                 "property");
 
+    addProperty(psdWidth,
+                0,
+                "psdWidth",
+                "",
+                "readwrite",
+                "bins",
+                "external",
+                "property");
+
+    addProperty(psdPooling,
+                "mean",
+                "psdPooling",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(waterfallResolution,
+                0.1,
+                "waterfallResolution",
+                "",
+                "readwrite",
+                "dB",
+                "external",
+                "property");
+
+    addProperty(waterfallKeyframeInterval,
+                32,
+                "waterfallKeyframeInterval",
+                "",
+                "readwrite",
+                "frames",
+                "external",
+                "property");
+
+    addProperty(crossSpectrumAvg,
+                16,
+                "crossSpectrumAvg",
+                "",
+                "readwrite",
+                "frames",
+                "external",
+                "property");
+
     addProperty(rfFreqUnits,
                 false,
                 "rfFreqUnits",
@@ -129,6 +182,180 @@ void psd_base::loadProperties()
                 "external",
                 "property");
 
+    addProperty(shmExport,
+                false,
+                "shmExport",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(shmPrefix,
+                "psd_",
+                "shmPrefix",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(shmDepth,
+                64,
+                "shmDepth",
+                "",
+                "readwrite",
+                "frames",
+                "external",
+                "property");
+
+    addProperty(idleTimeout,
+                0.0,
+                "idleTimeout",
+                "",
+                "readwrite",
+                "s",
+                "external",
+                "property");
+
+    addProperty(outputQueueDepth,
+                16,
+                "outputQueueDepth",
+                "",
+                "readwrite",
+                "frames",
+                "external",
+                "property");
+
+    addProperty(outputQueuePolicy,
+                "block",
+                "outputQueuePolicy",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(cpuAffinity,
+                "",
+                "cpuAffinity",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(realtimePriority,
+                0,
+                "realtimePriority",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(lockMemory,
+                false,
+                "lockMemory",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(traceEnabled,
+                false,
+                "traceEnabled",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(traceFile,
+                "",
+                "traceFile",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(autotune,
+                false,
+                "autotune",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(autotuneBudget,
+                2.0,
+                "autotuneBudget",
+                "",
+                "readwrite",
+                "s",
+                "external",
+                "property");
+
+    addProperty(autotuneCache,
+                "/var/tmp/rh.psd.autotune",
+                "autotuneCache",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(scratchMemory,
+                "scratchMemory",
+                "",
+                "readonly",
+                "bytes",
+                "external",
+                "property");
+
+    addProperty(outputBufferMemory,
+                "outputBufferMemory",
+                "",
+                "readonly",
+                "bytes",
+                "external",
+                "property");
+
+    addProperty(outputBufferAllocations,
+                "outputBufferAllocations",
+                "",
+                "readonly",
+                "",
+                "external",
+                "property");
+
+    addProperty(crossSpectrumPairs,
+                "crossSpectrumPairs",
+                "",
+                "readwrite",
+                "",
+                "external",
+                "property");
+
+    addProperty(transformConfig,
+                "transformConfig",
+                "",
+                "readonly",
+                "",
+                "external",
+                "property");
+
+    addProperty(streamStatus,
+                "streamStatus",
+                "",
+                "readonly",
+                "",
+                "external",
+                "property");
+
 }
 
 
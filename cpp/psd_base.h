@@ -23,6 +23,7 @@
 #include <ossie/ThreadedComponent.h>
 
 #include <bulkio/bulkio.h>
+#include "struct_props.h"
 
 class psd_base : public Component, protected ThreadedComponent
 {
@@ -48,8 +49,58 @@ class psd_base : public Component, protected ThreadedComponent
         CORBA::ULong numAvg;
         /// Property: logCoefficient
         float logCoefficient;
+        /// Property: psdWidth
+        CORBA::ULong psdWidth;
+        /// Property: psdPooling
+        std::string psdPooling;
+        /// Property: waterfallResolution
+        float waterfallResolution;
+        /// Property: waterfallKeyframeInterval
+        CORBA::ULong waterfallKeyframeInterval;
+        /// Property: crossSpectrumAvg
+        CORBA::ULong crossSpectrumAvg;
         /// Property: rfFreqUnits
         bool rfFreqUnits;
+        /// Property: shmExport
+        bool shmExport;
+        /// Property: shmPrefix
+        std::string shmPrefix;
+        /// Property: shmDepth
+        CORBA::ULong shmDepth;
+        /// Property: idleTimeout
+        float idleTimeout;
+        /// Property: outputQueueDepth
+        CORBA::ULong outputQueueDepth;
+        /// Property: outputQueuePolicy
+        std::string outputQueuePolicy;
+        /// Property: cpuAffinity
+        std::string cpuAffinity;
+        /// Property: realtimePriority
+        CORBA::Long realtimePriority;
+        /// Property: lockMemory
+        bool lockMemory;
+        /// Property: traceEnabled
+        bool traceEnabled;
+        /// Property: traceFile
+        std::string traceFile;
+        /// Property: autotune
+        bool autotune;
+        /// Property: autotuneBudget
+        float autotuneBudget;
+        /// Property: autotuneCache
+        std::string autotuneCache;
+        /// Property: scratchMemory
+        CORBA::ULongLong scratchMemory;
+        /// Property: outputBufferMemory
+        CORBA::ULongLong outputBufferMemory;
+        /// Property: outputBufferAllocations
+        CORBA::ULongLong outputBufferAllocations;
+        /// Property: crossSpectrumPairs
+        std::vector<cross_spectrum_pair_struct> crossSpectrumPairs;
+        /// Property: transformConfig
+        std::vector<transform_config_struct> transformConfig;
+        /// Property: streamStatus
+        std::vector<stream_status_struct> streamStatus;
 
         // Ports
         /// Port: dataFloat_in
@@ -58,6 +109,10 @@ class psd_base : public Component, protected ThreadedComponent
         bulkio::OutFloatPort *psd_dataFloat_out;
         /// Port: fft_dataFloat_out
         bulkio::OutFloatPort *fft_dataFloat_out;
+        /// Port: waterfall_dataOctet_out
+        bulkio::OutOctetPort *waterfall_dataOctet_out;
+        /// Port: csd_dataFloat_out
+        bulkio::OutFloatPort *csd_dataFloat_out;
 
     private:
 };
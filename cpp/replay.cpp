@@ -0,0 +1,356 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**************************************************************************
+
+    Offline replay of recorded data through the psd pipeline.
+
+    The input file is memory mapped and split into contiguous runs of
+    frames, one run per worker thread.  Each worker has its own
+    PsdPipeline and writes its output frames straight to their final
+    position in the output file, so the output is identical to processing
+    the file sequentially.  When averaging, runs are split on averaging
+    boundaries so no average spans two workers.
+
+    Trailing input that does not fill a whole frame (or a whole average)
+    is not processed.
+
+**************************************************************************/
+
+#include "replay.h"
+#include "pipeline.h"
+
+#include <boost/thread.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct ReplayOptions {
+    std::string input;
+    std::string output;
+    std::string fftOutput;
+    size_t fftSize;
+    int overlap;
+    size_t numAvg;
+    float logCoeff;
+    size_t psdWidth;
+    PsdPipeline::Pooling pooling;
+    bool complex;
+    unsigned int threads;
+};
+
+struct ReplayInput {
+    const char* map;
+    size_t mapBytes;
+    const float* data;
+    size_t samples;         // complex samples if complex
+    bool complex;
+    double xdelta;
+    bool blue;
+};
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: psd --replay [options] <input> <output>\n"
+            "  input is a BLUE file (type 1000, SF or CF) or raw 32-bit floats\n"
+            "  output is raw 32-bit float psd frames\n"
+            "options:\n"
+            "  --fftSize N          fft size (default 32768)\n"
+            "  --overlap N          overlap between frames (default 0)\n"
+            "  --numAvg N           number of frames to average (default 0)\n"
+            "  --logCoefficient X   log scale coefficient (default 0)\n"
+            "  --psdWidth N         pool the psd down to N bins (default 0, every bin)\n"
+            "  --psdPooling MODE    mean or max (default mean)\n"
+            "  --complex            raw input is interleaved complex\n"
+            "  --threads N          worker threads (default all cores)\n"
+            "  --fft FILE           also write the complex fft frames to FILE\n");
+}
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+bool parseArgs(int argc, char* argv[], ReplayOptions& opts)
+{
+    opts.fftSize = 32768;
+    opts.overlap = 0;
+    opts.numAvg = 0;
+    opts.logCoeff = 0;
+    opts.psdWidth = 0;
+    opts.pooling = PsdPipeline::POOL_MEAN;
+    opts.complex = false;
+    opts.threads = boost::thread::hardware_concurrency();
+
+    std::vector<std::string> files;
+    for (int i=1; i<argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i+1<argc;
+        if (arg=="--fftSize" && hasValue)
+            opts.fftSize = strtoul(argv[++i], NULL, 10);
+        else if (arg=="--overlap" && hasValue)
+            opts.overlap = strtol(argv[++i], NULL, 10);
+        else if (arg=="--numAvg" && hasValue)
+            opts.numAvg = strtoul(argv[++i], NULL, 10);
+        else if (arg=="--logCoefficient" && hasValue)
+            opts.logCoeff = strtod(argv[++i], NULL);
+        else if (arg=="--psdWidth" && hasValue)
+            opts.psdWidth = strtoul(argv[++i], NULL, 10);
+        else if (arg=="--psdPooling" && hasValue) {
+            if (!PsdPipeline::parsePooling(argv[++i], opts.pooling)) {
+                fprintf(stderr, "unknown pooling %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (arg=="--threads" && hasValue)
+            opts.threads = strtoul(argv[++i], NULL, 10);
+        else if (arg=="--fft" && hasValue)
+            opts.fftOutput = argv[++i];
+        else if (arg=="--complex")
+            opts.complex = true;
+        else if (arg.size()>1 && arg[0]=='-') {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        } else
+            files.push_back(arg);
+    }
+    if (files.size()!=2)
+        return false;
+    opts.input = files[0];
+    opts.output = files[1];
+    if (opts.fftSize==0 || opts.overlap>=int(opts.fftSize)) {
+        fprintf(stderr, "overlap must be less than fftSize\n");
+        return false;
+    }
+    if (opts.threads==0)
+        opts.threads = 1;
+    return true;
+}
+
+template <typename T>
+T headerField(const char* header, size_t offset)
+{
+    T value;
+    memcpy(&value, header+offset, sizeof(T));
+    return value;
+}
+
+bool openInput(const ReplayOptions& opts, ReplayInput& in)
+{
+    int fd = open(opts.input.c_str(), O_RDONLY);
+    if (fd<0) {
+        perror(opts.input.c_str());
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st)!=0 || st.st_size==0) {
+        fprintf(stderr, "%s: empty or unreadable\n", opts.input.c_str());
+        close(fd);
+        return false;
+    }
+    in.mapBytes = st.st_size;
+    void* ptr = mmap(NULL, in.mapBytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr==MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    in.map = static_cast<const char*>(ptr);
+    madvise(ptr, in.mapBytes, MADV_SEQUENTIAL);
+
+    size_t dataStart = 0;
+    size_t dataBytes = in.mapBytes;
+    in.complex = opts.complex;
+    in.xdelta = 1.0;
+    in.blue = in.mapBytes>=512 && memcmp(in.map, "BLUE", 4)==0;
+    if (in.blue) {
+        //512 byte BLUE header - only little endian float type 1000 files are supported
+        if (memcmp(in.map+8, "EEEI", 4)!=0) {
+            fprintf(stderr, "%s: only EEEI (little endian) BLUE data is supported\n", opts.input.c_str());
+            return false;
+        }
+        int32_t type = headerField<int32_t>(in.map, 48);
+        char format[3] = {in.map[52], in.map[53], 0};
+        if (type/1000!=1 || format[1]!='F' || (format[0]!='S' && format[0]!='C')) {
+            fprintf(stderr, "%s: unsupported BLUE type %d format %s\n", opts.input.c_str(), type, format);
+            return false;
+        }
+        in.complex = format[0]=='C';
+        dataStart = size_t(headerField<double>(in.map, 32));
+        dataBytes = size_t(headerField<double>(in.map, 40));
+        in.xdelta = headerField<double>(in.map, 264);
+        if (dataStart>in.mapBytes)
+            dataStart = in.mapBytes;
+        if (dataBytes>in.mapBytes-dataStart)
+            dataBytes = in.mapBytes-dataStart;
+    }
+    in.data = reinterpret_cast<const float*>(in.map+dataStart);
+    in.samples = dataBytes/sizeof(float)/(in.complex ? 2 : 1);
+    return true;
+}
+
+class ReplayWorker
+{
+public:
+    ReplayWorker(const ReplayOptions& opts, const ReplayInput& in, int psdFd, int fftFd,
+                 size_t firstGroup, size_t lastGroup) :
+        opts_(opts), in_(in), psdFd_(psdFd), fftFd_(fftFd),
+        firstGroup_(firstGroup), lastGroup_(lastGroup), failed_(false)
+    {
+    }
+
+    //only read once the worker has been joined
+    bool failed() const {return failed_;}
+
+    void operator()()
+    {
+        PsdPipeline pipeline(opts_.fftSize, opts_.numAvg);
+        pipeline.setNumAvg(opts_.numAvg);
+        pipeline.setPooling(opts_.psdWidth, opts_.pooling);
+        size_t framesPerGroup = opts_.numAvg>1 ? opts_.numAvg : 1;
+        size_t stride = opts_.fftSize-opts_.overlap;
+        size_t floatsPerSample = in_.complex ? 2 : 1;
+
+        for (size_t frame=firstGroup_*framesPerGroup; frame<lastGroup_*framesPerGroup; frame++) {
+            pipeline.run(in_.data+frame*stride*floatsPerSample, opts_.fftSize, in_.complex);
+
+            if (fftFd_>=0) {
+                size_t fftLen;
+                std::complex<float>* fft = pipeline.fft(fftLen);
+                if (!writeAt(fftFd_, fft, fftLen*sizeof(std::complex<float>), frame))
+                    return;
+            }
+
+            float* psd;
+            size_t psdLen;
+            // the fft has already been written, so the psd can reuse its buffer
+            if (pipeline.psd(opts_.logCoeff, psd, psdLen, false)) {
+                if (!writeAt(psdFd_, psd, psdLen*sizeof(float), frame/framesPerGroup))
+                    return;
+            }
+        }
+    }
+
+private:
+    bool writeAt(int fd, const void* data, size_t bytes, size_t index)
+    {
+        if (pwrite(fd, data, bytes, off_t(index)*bytes)!=ssize_t(bytes)) {
+            perror("write");
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    const ReplayOptions& opts_;
+    const ReplayInput& in_;
+    int psdFd_;
+    int fftFd_;
+    size_t firstGroup_;
+    size_t lastGroup_;
+    bool failed_;
+};
+
+}
+
+int replayMain(int argc, char* argv[])
+{
+    ReplayOptions opts;
+    if (!parseArgs(argc, argv, opts)) {
+        usage();
+        return 1;
+    }
+    ReplayInput in;
+    if (!openInput(opts, in))
+        return 1;
+
+    int psdFd = open(opts.output.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (psdFd<0) {
+        perror(opts.output.c_str());
+        return 1;
+    }
+    int fftFd = -1;
+    if (!opts.fftOutput.empty()) {
+        fftFd = open(opts.fftOutput.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+        if (fftFd<0) {
+            perror(opts.fftOutput.c_str());
+            return 1;
+        }
+    }
+
+    size_t stride = opts.fftSize-opts.overlap;
+    size_t frames = in.samples>=opts.fftSize ? (in.samples-opts.fftSize)/stride+1 : 0;
+    size_t framesPerGroup = opts.numAvg>1 ? opts.numAvg : 1;
+    size_t groups = frames/framesPerGroup;
+    unsigned int threads = opts.threads;
+    if (threads>groups)
+        threads = groups>0 ? groups : 1;
+
+    fprintf(stderr, "replay: %s %lu %s samples, fftSize %lu, overlap %d, numAvg %lu, %u threads\n",
+            opts.input.c_str(), (unsigned long)in.samples, in.complex ? "complex" : "real",
+            (unsigned long)opts.fftSize, opts.overlap, (unsigned long)opts.numAvg, threads);
+
+    double start = now();
+    boost::thread_group workers;
+    std::vector<ReplayWorker*> jobs;
+    for (unsigned int t=0; t<threads; t++) {
+        size_t first = groups*t/threads;
+        size_t last = groups*(t+1)/threads;
+        jobs.push_back(new ReplayWorker(opts, in, psdFd, fftFd, first, last));
+        workers.create_thread(boost::ref(*jobs.back()));
+    }
+    workers.join_all();
+    double elapsed = now()-start;
+    bool failed = false;
+    for (size_t i=0; i<jobs.size(); i++) {
+        failed = failed || jobs[i]->failed();
+        delete jobs[i];
+    }
+
+    close(psdFd);
+    if (fftFd>=0)
+        close(fftFd);
+    munmap(const_cast<char*>(in.map), in.mapBytes);
+    if (failed)
+        return 1;
+
+    size_t processed = groups*framesPerGroup;
+    double inputSamples = processed>0 ? double((processed-1)*stride+opts.fftSize) : 0.0;
+    printf("replay: %lu frames (%lu psd frames) in %.3f s\n", (unsigned long)processed, (unsigned long)groups, elapsed);
+    if (elapsed>0) {
+        printf("replay: %.1f frames/s, %.2f Msamples/s",
+               processed/elapsed, inputSamples/elapsed*1e-6);
+        if (in.blue && in.xdelta>0)
+            printf(", %.1fx real time", inputSamples*in.xdelta/elapsed);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "samplering.h"
+
+#include <algorithm>
+#include <cstring>
+
+SampleRing::SampleRing() :
+    frameSz_(0),
+    strideSz_(0),
+    complex_(false),
+    start_(0),
+    end_(0)
+{
+}
+
+void SampleRing::configure(size_t frameSize, size_t strideSize, bool complex)
+{
+    if (frameSize==frameSz_ && strideSize==strideSz_ && complex==complex_)
+        return;
+    frameSz_ = frameSize;
+    strideSz_ = strideSize;
+    complex_ = complex;
+    clear();
+    buffer_.resize((frameSz_+std::max(frameSz_, strideSz_))*floatsPerSample());
+}
+
+void SampleRing::clear()
+{
+    start_ = 0;
+    end_ = 0;
+}
+
+void SampleRing::release()
+{
+    clear();
+    frameSz_ = 0;
+    strideSz_ = 0;
+    RealFFTWVector().swap(buffer_);
+}
+
+void SampleRing::relocate()
+{
+    RealFFTWVector(buffer_).swap(buffer_);
+}
+
+void SampleRing::append(const float* data, size_t samples)
+{
+    size_t floats = samples*floatsPerSample();
+    if (end_+floats > buffer_.size()) {
+        memmove(&buffer_[0], &buffer_[start_], (end_-start_)*sizeof(float));
+        end_ -= start_;
+        start_ = 0;
+    }
+    memcpy(&buffer_[end_], data, floats*sizeof(float));
+    end_ += floats;
+}
+
+void SampleRing::advance()
+{
+    start_ += std::min(strideSz_*floatsPerSample(), end_-start_);
+    if (start_==end_)
+        clear();
+}
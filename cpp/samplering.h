@@ -0,0 +1,72 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_SAMPLERING_H
+#define PSD_SAMPLERING_H
+
+#include "fft.h"
+
+class SampleRing
+{
+    //input history for overlapped frames
+    //
+    //new samples are appended once and each frame is a contiguous window into
+    //the buffer, so overlapped samples are never copied per frame.  The buffer
+    //holds at least one extra frame (or stride) past the window - when the tail
+    //reaches the end the unconsumed samples are moved back to the front, which
+    //amortizes to a fraction of the overlap per frame.
+    //
+    //all counts are in samples (complex samples if complex)
+public:
+    SampleRing();
+
+    void configure(size_t frameSize, size_t strideSize, bool complex);
+    void clear();
+
+    //clear and free the buffer - the next configure() reallocates it
+    void release();
+
+    //copy the buffer into memory first touched by the calling thread
+    void relocate();
+    size_t memoryBytes() const {return buffer_.capacity()*sizeof(float);}
+
+    bool complex() const {return complex_;}
+    size_t size() const {return (end_-start_)/floatsPerSample();}
+    bool full() const {return size()>=frameSz_;}
+
+    //samples to append before the next window is full
+    size_t needed() const {return full() ? 0 : frameSz_-size();}
+
+    void append(const float* data, size_t samples);
+    const float* window() const {return &buffer_[start_];}
+
+    //move the window on by one stride
+    void advance();
+
+private:
+    size_t floatsPerSample() const {return complex_ ? 2 : 1;}
+
+    RealFFTWVector buffer_;
+    size_t frameSz_;
+    size_t strideSz_;
+    bool complex_;
+    size_t start_;  // in floats
+    size_t end_;    // in floats
+};
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "scratch.h"
+
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+
+size_t ScratchArena::bytes() const
+{
+    return padded.bytes() + fftOut.bytes() + psdOut.bytes();
+}
+
+ScratchPool& ScratchPool::instance()
+{
+    static ScratchPool pool;
+    return pool;
+}
+
+ScratchPool::ScratchPool() :
+    maxFree_(std::max(1u, boost::thread::hardware_concurrency())),
+    kept_(&ScratchPool::threadExit),
+    bytes_(0),
+    lockMemory_(false),
+    lockGeneration_(0),
+    lockFailures_(0)
+{
+}
+
+ScratchPool::~ScratchPool()
+{
+    releaseThread();
+    for (std::map<int, std::vector<ScratchArena*> >::iterator node=free_.begin(); node!=free_.end(); ++node) {
+        for (size_t i=0; i<node->second.size(); i++)
+            delete node->second[i];
+    }
+}
+
+ScratchArena* ScratchPool::lease()
+{
+    int node = ThreadPlacement::currentNode();
+    ScratchArena* arena = kept_.release();
+    if (arena) {
+        if (arena->node==node)
+            return arena;
+        //the thread has moved - the arena belongs on its own node's list
+        giveBack(arena);
+    }
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        std::vector<ScratchArena*>& free = free_[node];
+        if (!free.empty()) {
+            arena = free.back();
+            free.pop_back();
+            size_t& lowWater = lowWater_[node];
+            lowWater = std::min(lowWater, free.size());
+            return arena;
+        }
+    }
+    arena = new ScratchArena();
+    arena->node = node;
+    arena->locked = false;
+    arena->lockFailed = false;
+    arena->lockGeneration = 0;
+    arena->accounted = 0;
+    return arena;
+}
+
+void ScratchPool::release(ScratchArena* arena)
+{
+    //the arena may have grown while it was leased (unsigned wraparound makes
+    //the difference come out right if it somehow shrank)
+    size_t bytes = arena->bytes();
+    __sync_fetch_and_add(&bytes_, bytes-arena->accounted);
+    arena->accounted = bytes;
+    if (!kept_.get()) {
+        kept_.reset(arena);
+    } else {
+        giveBack(arena);
+    }
+}
+
+void ScratchPool::releaseThread()
+{
+    ScratchArena* arena = kept_.release();
+    if (arena)
+        giveBack(arena);
+}
+
+void ScratchPool::threadExit(ScratchArena* arena)
+{
+    instance().giveBack(arena);
+}
+
+void ScratchPool::giveBack(ScratchArena* arena)
+{
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        std::vector<ScratchArena*>& free = free_[arena->node];
+        if (free.size()<maxFree_) {
+            free.push_back(arena);
+            return;
+        }
+    }
+    destroy(arena);
+}
+
+void ScratchPool::trim()
+{
+    //the least recently used arenas are at the front of each list
+    std::vector<ScratchArena*> unused;
+    {
+        boost::mutex::scoped_lock lock(lock_);
+        size_t remaining = 0;
+        for (std::map<int, std::vector<ScratchArena*> >::iterator node=free_.begin(); node!=free_.end(); ++node) {
+            std::vector<ScratchArena*>& free = node->second;
+            size_t count = std::min(lowWater_[node->first], free.size());
+            unused.insert(unused.end(), free.begin(), free.begin()+count);
+            free.erase(free.begin(), free.begin()+count);
+            remaining += free.size();
+        }
+        //keep one, so a stream starting up again has an arena ready
+        if (remaining==0 && !unused.empty()) {
+            free_[unused.back()->node].push_back(unused.back());
+            unused.pop_back();
+        }
+        for (std::map<int, std::vector<ScratchArena*> >::iterator node=free_.begin(); node!=free_.end(); ++node)
+            lowWater_[node->first] = node->second.size();
+    }
+    for (size_t i=0; i<unused.size(); i++)
+        destroy(unused[i]);
+}
+
+void ScratchPool::destroy(ScratchArena* arena)
+{
+    __sync_fetch_and_sub(&bytes_, arena->accounted);
+    unlock(arena);
+    delete arena;
+}
+
+void ScratchPool::prepare(ScratchArena* arena, size_t outLen, size_t inFloats)
+{
+    unsigned generation = lockGeneration_;
+    bool lockMemory = lockMemory_;
+    if (arena->lockGeneration!=generation) {
+        //lockMemory has been set since the last attempt - worth another try
+        arena->lockFailed = false;
+        arena->lockGeneration = generation;
+    }
+    bool grow = arena->fftOut.size()<outLen || arena->psdOut.size()<outLen || arena->padded.size()<inFloats;
+    if (grow) {
+        //growing zeroes the new pages, which faults them in from this thread
+        unlock(arena);
+        arena->fftOut.grow(outLen);
+        arena->psdOut.grow(outLen);
+        arena->padded.grow(inFloats);
+    }
+    if (lockMemory && !arena->locked && !arena->lockFailed) {
+        lock(arena);
+    } else if (!lockMemory && arena->locked) {
+        unlock(arena);
+    }
+}
+
+void ScratchPool::lock(ScratchArena* arena)
+{
+    arena->locked = ThreadPlacement::lockPages(&arena->fftOut[0], arena->fftOut.bytes())
+        && ThreadPlacement::lockPages(&arena->psdOut[0], arena->psdOut.bytes())
+        && (arena->padded.empty() || ThreadPlacement::lockPages(&arena->padded[0], arena->padded.bytes()));
+    if (!arena->locked) {
+        unlock(arena);
+        arena->lockFailed = true;
+        __sync_fetch_and_add(&lockFailures_, 1);
+    }
+}
+
+void ScratchPool::unlock(ScratchArena* arena)
+{
+    //the buffers own their pages, so this can not unlock anyone else's
+    //memory, and munlock on pages that were never locked does nothing
+    if (!arena->fftOut.empty())
+        ThreadPlacement::unlockPages(&arena->fftOut[0], arena->fftOut.bytes());
+    if (!arena->psdOut.empty())
+        ThreadPlacement::unlockPages(&arena->psdOut[0], arena->psdOut.bytes());
+    if (!arena->padded.empty())
+        ThreadPlacement::unlockPages(&arena->padded[0], arena->padded.bytes());
+    arena->locked = false;
+}
+
+void ScratchPool::setLockMemory(bool lock)
+{
+    //arenas pick this up the next time they are prepared
+    if (lock==lockMemory_)
+        return;
+    lockMemory_ = lock;
+    __sync_fetch_and_add(&lockGeneration_, 1);
+}
+
+size_t ScratchPool::bytes()
+{
+    return bytes_;
+}
+
+size_t ScratchPool::lockFailures()
+{
+    return lockFailures_;
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_SCRATCH_H
+#define PSD_SCRATCH_H
+
+#include <complex>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include "placement.h"
+
+template <typename T>
+class PageBuffer : boost::noncopyable
+{
+    //working buffer on pages of its own, so locking or unlocking it never
+    //changes a neighbouring allocation - mlock works on whole pages
+    //
+    //page alignment covers the simd alignment fftw wants
+public:
+    PageBuffer() : data_(NULL), size_(0) {}
+    ~PageBuffer() {free(data_);}
+
+    //make room for at least count elements - the contents are not kept, and
+    //the new pages are zeroed, and so first touched, by the calling thread
+    void grow(size_t count)
+    {
+        if (count<=size_)
+            return;
+        size_t bytes = ThreadPlacement::roundPages(count*sizeof(T));
+        free(data_);
+        data_ = NULL;
+        size_ = 0;
+        data_ = static_cast<T*>(ThreadPlacement::allocatePages(bytes));
+        memset(static_cast<void*>(data_), 0, bytes);
+        size_ = bytes/sizeof(T);
+    }
+
+    T& operator[](size_t index) {return data_[index];}
+    size_t size() const {return size_;}
+    bool empty() const {return size_==0;}
+    //whole pages
+    size_t bytes() const {return size_*sizeof(T);}
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+struct ScratchArena
+{
+    //per-frame working buffers - contents never outlive one frame, so any
+    //stream can use any arena
+    //
+    //the buffers are sized for the largest frame seen (rounded up to whole
+    //pages) and never shrink; use the frame's own lengths rather than size()
+    PageBuffer<float> padded;
+    PageBuffer<std::complex<float> > fftOut;
+    PageBuffer<float> psdOut;
+
+    size_t bytes() const;
+
+    //numa node the buffers were first touched on
+    int node;
+    bool locked;
+    //mlock failed - not tried again until lockMemory is next set
+    bool lockFailed;
+    //the lockMemory setting lockFailed applies to
+    unsigned lockGeneration;
+
+    //bytes last reported to the pool
+    size_t accounted;
+};
+
+class ScratchPool
+{
+    //process wide pool of scratch arenas
+    //
+    //a processing thread leases an arena only while it is working on a frame,
+    //so the number of arenas follows the number of threads that are actually
+    //busy rather than the number of streams.  Released arenas go back on a
+    //free list (most recently used first, as its buffers are most likely still
+    //in cache); the free list is capped at the number of cores and anything
+    //beyond that is freed.  trim() frees the arenas that have gone unused
+    //since its last call, so a quiet component holds a single arena.
+    //
+    //there is a free list per numa node.  A thread leases from the list for
+    //the node it is running on, and new arenas are sized (and so first
+    //touched) by the leasing thread, which keeps them local to it.
+    //
+    //a thread keeps the arena it last released for its next lease, so a busy
+    //thread works frame after frame without touching the pool's lock; the
+    //arena goes back on the free lists when the thread runs out of input and
+    //calls releaseThread(), moves node or exits.
+public:
+    static ScratchPool& instance();
+
+    ScratchArena* lease();
+    void release(ScratchArena* arena);
+
+    //hand the calling thread's kept arena back to the free lists, for a
+    //thread that has no input waiting
+    void releaseThread();
+
+    //free the arenas that have stayed on the free lists since the last call,
+    //keeping one - call periodically
+    void trim();
+
+    //make sure the arena can take an fft of outLen bins from inFloats of
+    //padded input - growing it faults the new pages in, and locks them if
+    //lockMemory is set
+    void prepare(ScratchArena* arena, size_t outLen, size_t inFloats);
+
+    //keep arena memory resident with mlock
+    void setLockMemory(bool lock);
+
+    //total bytes held by all arenas, leased or free
+    size_t bytes();
+
+    //number of times mlock has failed (usually RLIMIT_MEMLOCK) - an arena
+    //that fails is not tried again until lockMemory is set again
+    size_t lockFailures();
+
+private:
+    ScratchPool();
+    ~ScratchPool();
+
+    //back on the free list for its node, or freed if that is full
+    void giveBack(ScratchArena* arena);
+    void destroy(ScratchArena* arena);
+    static void threadExit(ScratchArena* arena);
+
+    void lock(ScratchArena* arena);
+    void unlock(ScratchArena* arena);
+
+    //guards the free lists only - the rest is per thread or atomic
+    boost::mutex lock_;
+    std::map<int, std::vector<ScratchArena*> > free_;
+    //shortest each free list has been since the last trim - that many were
+    //never needed
+    std::map<int, size_t> lowWater_;
+    size_t maxFree_;
+    boost::thread_specific_ptr<ScratchArena> kept_;
+    volatile size_t bytes_;
+    volatile bool lockMemory_;
+    //bumped on each change of lockMemory_
+    volatile unsigned lockGeneration_;
+    volatile size_t lockFailures_;
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "shmring.h"
+
+#include <bulkio/bulkio.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ShmRing::ShmRing(const std::string& name, const std::string& streamID) :
+    name_(name),
+    streamID_(streamID),
+    header_(NULL),
+    mapBytes_(0)
+{
+}
+
+ShmRing::~ShmRing()
+{
+    close(true);
+}
+
+std::string ShmRing::shmName(const std::string& prefix, const std::string& streamID)
+{
+    //shm_open names are a single path component
+    std::string name = "/"+prefix+streamID;
+    for (size_t i=1; i<name.size(); i++) {
+        if (name[i]=='/')
+            name[i]='_';
+    }
+    return name;
+}
+
+bool ShmRing::configure(size_t maxLength, size_t depth)
+{
+    if (depth==0)
+        depth=1;
+    if (header_ && header_->maxLength>=maxLength && header_->slotCount==depth)
+        return true;
+
+    //readers may still have the old ring mapped - tell them to go find the new one
+    close(true);
+
+    //keep every slot cache line aligned
+    size_t slotBytes = PSD_SHM_SLOT_HEADER_BYTES+maxLength*sizeof(float);
+    slotBytes = (slotBytes+63) & ~size_t(63);
+    size_t bytes = PSD_SHM_HEADER_BYTES+depth*slotBytes;
+
+    //another instance (or its readers) may be using the name - only a ring
+    //left behind by a writer that is gone is replaced
+    int fd = shm_open(name_.c_str(), O_RDWR|O_CREAT|O_EXCL, 0644);
+    if (fd<0 && errno==EEXIST && stale()) {
+        shm_unlink(name_.c_str());
+        fd = shm_open(name_.c_str(), O_RDWR|O_CREAT|O_EXCL, 0644);
+    }
+    if (fd<0)
+        return false;
+    if (ftruncate(fd, bytes)!=0) {
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    void* ptr = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr==MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    mapBytes_ = bytes;
+    header_ = static_cast<PsdShmHeader*>(ptr);
+    memset(header_, 0, sizeof(PsdShmHeader));
+    header_->version = PSD_SHM_VERSION;
+    header_->headerBytes = PSD_SHM_HEADER_BYTES;
+    header_->slotCount = depth;
+    header_->slotBytes = slotBytes;
+    header_->maxLength = maxLength;
+    strncpy(header_->streamID, streamID_.c_str(), PSD_SHM_STREAMID_BYTES-1);
+    header_->writerPid = getpid();
+    //magic goes in last so a reader never sees a half initialized header
+    __sync_synchronize();
+    memcpy(header_->magic, PSD_SHM_MAGIC, sizeof(header_->magic));
+    return true;
+}
+
+bool ShmRing::stale()
+{
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd<0)
+        return errno==ENOENT;
+    struct stat st;
+    bool stale = false;
+    if (fstat(fd, &st)==0 && size_t(st.st_size)>=sizeof(PsdShmHeader)) {
+        void* ptr = mmap(NULL, sizeof(PsdShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr!=MAP_FAILED) {
+            //a ring without the magic may still be being set up by its writer
+            const PsdShmHeader* header = static_cast<const PsdShmHeader*>(ptr);
+            if (memcmp(header->magic, PSD_SHM_MAGIC, sizeof(header->magic))==0) {
+                stale = header->closed ||
+                        (header->writerPid>0 && kill(header->writerPid, 0)!=0 && errno==ESRCH);
+            }
+            munmap(ptr, sizeof(PsdShmHeader));
+        }
+    }
+    ::close(fd);
+    return stale;
+}
+
+void ShmRing::close(bool unlink)
+{
+    if (header_) {
+        header_->closed = 1;
+        __sync_synchronize();
+        munmap(header_, mapBytes_);
+        header_ = NULL;
+        mapBytes_ = 0;
+        if (unlink)
+            shm_unlink(name_.c_str());
+    }
+}
+
+PsdShmSlot* ShmRing::slot(uint64_t frame)
+{
+    char* base = reinterpret_cast<char*>(header_)+PSD_SHM_HEADER_BYTES;
+    return reinterpret_cast<PsdShmSlot*>(base+(frame%header_->slotCount)*header_->slotBytes);
+}
+
+void ShmRing::publishSRI(const BULKIO::StreamSRI& sri)
+{
+    if (!header_)
+        return;
+    header_->sriSeq++;
+    __sync_synchronize();
+    header_->xstart = sri.xstart;
+    header_->xdelta = sri.xdelta;
+    header_->ydelta = sri.ydelta;
+    header_->subsize = sri.subsize;
+    header_->mode = sri.mode;
+    header_->xunits = sri.xunits;
+    header_->yunits = sri.yunits;
+    __sync_synchronize();
+    header_->sriSeq++;
+}
+
+void ShmRing::publishFrame(const float* data, size_t length, const BULKIO::PrecisionUTCTime& time)
+{
+    if (!header_)
+        return;
+    if (length>header_->maxLength)
+        length=header_->maxLength;
+
+    uint64_t frame = header_->writeSeq;
+    PsdShmSlot* s = slot(frame);
+    s->seq = 2*frame+1;
+    __sync_synchronize();
+    s->frame = frame;
+    s->length = length;
+    s->sriSeq = header_->sriSeq;
+    s->twsec = time.twsec;
+    s->tfsec = time.tfsec;
+    memcpy(reinterpret_cast<char*>(s)+PSD_SHM_SLOT_HEADER_BYTES, data, length*sizeof(float));
+    __sync_synchronize();
+    s->seq = 2*frame+2;
+    header_->writeSeq = frame+1;
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_SHMRING_H
+#define PSD_SHMRING_H
+
+#include <stdint.h>
+#include <string>
+
+//Layout of a PSD frame ring exported to /dev/shm
+//
+//The file starts with a PsdShmHeader padded out to PSD_SHM_HEADER_BYTES, followed by slotCount
+//slots of slotBytes each.  Every slot is a PsdShmSlot followed by up to maxLength floats.
+//Frame n (counting from 0) is stored in slot n % slotCount.
+//
+//The writer never waits on readers.  Each slot and the SRI block are guarded by a sequence count
+//which is odd while the writer is updating them.  A reader snapshots the count, uses the data in
+//place and then re-reads the count - if it changed (or was odd) the data was overwritten while
+//it was being read and must be discarded.  A completed slot holding frame n has seq == 2*n+2.
+//
+//If the writer has to grow the ring (new fftSize) it sets closed=1 on the old file and unlinks
+//it before creating a new one under the same name, so readers should re-open when they see it.
+//A writer never replaces a ring it does not own - only one that is closed, or whose writerPid
+//has exited.
+
+#define PSD_SHM_MAGIC "RHPSDSHM"
+#define PSD_SHM_VERSION 1
+#define PSD_SHM_HEADER_BYTES 4096
+#define PSD_SHM_SLOT_HEADER_BYTES 64
+#define PSD_SHM_STREAMID_BYTES 256
+
+struct PsdShmHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t slotCount;
+    uint32_t slotBytes;
+    uint32_t maxLength;
+    volatile uint32_t closed;
+    volatile uint64_t writeSeq;     // number of frames published so far
+    volatile uint64_t sriSeq;       // seqlock count for the SRI fields below
+    double xstart;
+    double xdelta;
+    double ydelta;
+    int32_t subsize;
+    int32_t mode;
+    int32_t xunits;
+    int32_t yunits;
+    char streamID[PSD_SHM_STREAMID_BYTES];
+    int32_t writerPid;              // process that owns the ring
+};
+
+struct PsdShmSlot {
+    volatile uint64_t seq;
+    uint64_t frame;
+    uint32_t length;                // number of floats in this frame
+    uint32_t sriSeq;                // header sriSeq in effect when the frame was written
+    double twsec;
+    double tfsec;
+    char pad[PSD_SHM_SLOT_HEADER_BYTES-40];
+};
+
+namespace BULKIO {
+    struct StreamSRI;
+    struct PrecisionUTCTime;
+}
+
+class ShmRing
+{
+    //writer side of the /dev/shm PSD frame ring
+public:
+    ShmRing(const std::string& name, const std::string& streamID);
+    ~ShmRing();
+
+    //(re)size the ring - returns false if the shared memory could not be mapped
+    bool configure(size_t maxLength, size_t depth);
+    bool valid() const {return header_!=NULL;}
+    const std::string& name() const {return name_;}
+    size_t mappedBytes() const {return mapBytes_;}
+
+    void publishSRI(const BULKIO::StreamSRI& sri);
+    void publishFrame(const float* data, size_t length, const BULKIO::PrecisionUTCTime& time);
+
+    //convert a stream ID into a name usable with shm_open
+    static std::string shmName(const std::string& prefix, const std::string& streamID);
+
+private:
+    void close(bool unlink);
+    bool stale();
+    PsdShmSlot* slot(uint64_t frame);
+
+    std::string name_;
+    std::string streamID_;
+    PsdShmHeader* header_;
+    size_t mapBytes_;
+};
+
+#endif
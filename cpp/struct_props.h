@@ -0,0 +1,229 @@
+#ifndef STRUCTPROPS_H
+#define STRUCTPROPS_H
+
+/*******************************************************************************************
+
+    AUTO-GENERATED CODE. DO NOT MODIFY
+
+*******************************************************************************************/
+
+#include <ossie/CorbaUtils.h>
+#include <CF/cf.h>
+#include <ossie/PropertyMap.h>
+
+struct stream_status_struct {
+    stream_status_struct ()
+    {
+    }
+
+    static std::string getId() {
+        return std::string("streamStatus::stream_status");
+    }
+
+    static const char* getFormat() {
+        return "sQ?IQ";
+    }
+
+    std::string streamID;
+    CORBA::ULongLong memoryBytes;
+    bool idle;
+    CORBA::ULong queueDepth;
+    CORBA::ULongLong droppedFrames;
+};
+
+inline bool operator>>= (const CORBA::Any& a, stream_status_struct& s) {
+    CF::Properties* temp;
+    if (!(a >>= temp)) return false;
+    const redhawk::PropertyMap& props = redhawk::PropertyMap::cast(*temp);
+    if (props.contains("streamStatus::streamID")) {
+        if (!(props["streamStatus::streamID"] >>= s.streamID)) return false;
+    }
+    if (props.contains("streamStatus::memoryBytes")) {
+        if (!(props["streamStatus::memoryBytes"] >>= s.memoryBytes)) return false;
+    }
+    if (props.contains("streamStatus::idle")) {
+        if (!(props["streamStatus::idle"] >>= s.idle)) return false;
+    }
+    if (props.contains("streamStatus::queueDepth")) {
+        if (!(props["streamStatus::queueDepth"] >>= s.queueDepth)) return false;
+    }
+    if (props.contains("streamStatus::droppedFrames")) {
+        if (!(props["streamStatus::droppedFrames"] >>= s.droppedFrames)) return false;
+    }
+    return true;
+}
+
+inline void operator<<= (CORBA::Any& a, const stream_status_struct& s) {
+    redhawk::PropertyMap props;
+ 
+    props["streamStatus::streamID"] = s.streamID;
+ 
+    props["streamStatus::memoryBytes"] = s.memoryBytes;
+ 
+    props["streamStatus::idle"] = s.idle;
+ 
+    props["streamStatus::queueDepth"] = s.queueDepth;
+ 
+    props["streamStatus::droppedFrames"] = s.droppedFrames;
+    a <<= props;
+}
+
+inline bool operator== (const stream_status_struct& s1, const stream_status_struct& s2) {
+    if (s1.streamID!=s2.streamID)
+        return false;
+    if (s1.memoryBytes!=s2.memoryBytes)
+        return false;
+    if (s1.idle!=s2.idle)
+        return false;
+    if (s1.queueDepth!=s2.queueDepth)
+        return false;
+    if (s1.droppedFrames!=s2.droppedFrames)
+        return false;
+    return true;
+}
+
+inline bool operator!= (const stream_status_struct& s1, const stream_status_struct& s2) {
+    return !(s1==s2);
+}
+
+struct transform_config_struct {
+    transform_config_struct ()
+    {
+        mode = "real";
+        planRigor = "measure";
+        fftwThreads = 1;
+        batchFrames = 1;
+        nsPerFrame = 0;
+        source = "default";
+    }
+
+    static std::string getId() {
+        return std::string("transformConfig::transform_config");
+    }
+
+    static const char* getFormat() {
+        return "ssIIds";
+    }
+
+    std::string mode;
+    std::string planRigor;
+    CORBA::ULong fftwThreads;
+    CORBA::ULong batchFrames;
+    double nsPerFrame;
+    std::string source;
+};
+
+inline bool operator>>= (const CORBA::Any& a, transform_config_struct& s) {
+    CF::Properties* temp;
+    if (!(a >>= temp)) return false;
+    const redhawk::PropertyMap& props = redhawk::PropertyMap::cast(*temp);
+    if (props.contains("transformConfig::mode")) {
+        if (!(props["transformConfig::mode"] >>= s.mode)) return false;
+    }
+    if (props.contains("transformConfig::planRigor")) {
+        if (!(props["transformConfig::planRigor"] >>= s.planRigor)) return false;
+    }
+    if (props.contains("transformConfig::fftwThreads")) {
+        if (!(props["transformConfig::fftwThreads"] >>= s.fftwThreads)) return false;
+    }
+    if (props.contains("transformConfig::batchFrames")) {
+        if (!(props["transformConfig::batchFrames"] >>= s.batchFrames)) return false;
+    }
+    if (props.contains("transformConfig::nsPerFrame")) {
+        if (!(props["transformConfig::nsPerFrame"] >>= s.nsPerFrame)) return false;
+    }
+    if (props.contains("transformConfig::source")) {
+        if (!(props["transformConfig::source"] >>= s.source)) return false;
+    }
+    return true;
+}
+
+inline void operator<<= (CORBA::Any& a, const transform_config_struct& s) {
+    redhawk::PropertyMap props;
+ 
+    props["transformConfig::mode"] = s.mode;
+ 
+    props["transformConfig::planRigor"] = s.planRigor;
+ 
+    props["transformConfig::fftwThreads"] = s.fftwThreads;
+ 
+    props["transformConfig::batchFrames"] = s.batchFrames;
+ 
+    props["transformConfig::nsPerFrame"] = s.nsPerFrame;
+ 
+    props["transformConfig::source"] = s.source;
+    a <<= props;
+}
+
+inline bool operator== (const transform_config_struct& s1, const transform_config_struct& s2) {
+    if (s1.mode!=s2.mode)
+        return false;
+    if (s1.planRigor!=s2.planRigor)
+        return false;
+    if (s1.fftwThreads!=s2.fftwThreads)
+        return false;
+    if (s1.batchFrames!=s2.batchFrames)
+        return false;
+    if (s1.nsPerFrame!=s2.nsPerFrame)
+        return false;
+    if (s1.source!=s2.source)
+        return false;
+    return true;
+}
+
+inline bool operator!= (const transform_config_struct& s1, const transform_config_struct& s2) {
+    return !(s1==s2);
+}
+
+struct cross_spectrum_pair_struct {
+    cross_spectrum_pair_struct ()
+    {
+    }
+
+    static std::string getId() {
+        return std::string("crossSpectrumPairs::cross_spectrum_pair");
+    }
+
+    static const char* getFormat() {
+        return "ss";
+    }
+
+    std::string streamA;
+    std::string streamB;
+};
+
+inline bool operator>>= (const CORBA::Any& a, cross_spectrum_pair_struct& s) {
+    CF::Properties* temp;
+    if (!(a >>= temp)) return false;
+    const redhawk::PropertyMap& props = redhawk::PropertyMap::cast(*temp);
+    if (props.contains("crossSpectrumPairs::streamA")) {
+        if (!(props["crossSpectrumPairs::streamA"] >>= s.streamA)) return false;
+    }
+    if (props.contains("crossSpectrumPairs::streamB")) {
+        if (!(props["crossSpectrumPairs::streamB"] >>= s.streamB)) return false;
+    }
+    return true;
+}
+
+inline void operator<<= (CORBA::Any& a, const cross_spectrum_pair_struct& s) {
+    redhawk::PropertyMap props;
+ 
+    props["crossSpectrumPairs::streamA"] = s.streamA;
+ 
+    props["crossSpectrumPairs::streamB"] = s.streamB;
+    a <<= props;
+}
+
+inline bool operator== (const cross_spectrum_pair_struct& s1, const cross_spectrum_pair_struct& s2) {
+    if (s1.streamA!=s2.streamA)
+        return false;
+    if (s1.streamB!=s2.streamB)
+        return false;
+    return true;
+}
+
+inline bool operator!= (const cross_spectrum_pair_struct& s1, const cross_spectrum_pair_struct& s2) {
+    return !(s1==s2);
+}
+
+#endif // STRUCTPROPS_H
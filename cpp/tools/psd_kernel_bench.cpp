@@ -0,0 +1,183 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+/**************************************************************************
+
+    Benchmark of the post-fft kernels (see kernels.h).
+
+    Runs the per-output-frame chain with two averages - magnitude of both
+    frames, sum, mean and log - for each fixed fft size, real and complex,
+    with the plain scalar loops the pipeline used before the kernels, the
+    generic kernels and the size specialized kernels, and prints the time
+    per frame for each.
+
+    usage: psd_kernel_bench [-t seconds per case]
+
+**************************************************************************/
+
+#include "../kernels.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <vector>
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// the loops PsdPipeline ran before the kernels, for reference
+static void scalarMagnitude(const std::complex<float>* in, float* out, size_t len)
+{
+    for (size_t i=0; i<len; i++)
+        out[i] = std::norm(in[i]);
+}
+
+static void scalarMagnitudeShifted(const std::complex<float>* in, float* out, size_t len)
+{
+    size_t half = len/2;
+    size_t rest = len-half;
+    for (size_t i=0; i<half; i++)
+        out[i] = std::norm(in[i+rest]);
+    for (size_t i=half; i<len; i++)
+        out[i] = std::norm(in[i-half]);
+}
+
+static void scalarAccumulate(float* sum, const float* in, size_t len)
+{
+    for (size_t i=0; i<len; i++)
+        sum[i] += in[i];
+}
+
+static void scalarMean(const float* sum, float scale, float* out, size_t len)
+{
+    for (size_t i=0; i<len; i++)
+        out[i] = sum[i]*scale;
+}
+
+static void scalarLog(float* data, float coeff, size_t len)
+{
+    for (size_t i=0; i<len; i++)
+        data[i] = coeff*log10(data[i]);
+}
+
+static PsdKernels scalar()
+{
+    PsdKernels k = PsdKernels::generic();
+    k.magnitude = &scalarMagnitude;
+    k.magnitudeShifted = &scalarMagnitudeShifted;
+    k.accumulate = &scalarAccumulate;
+    k.mean = &scalarMean;
+    k.log = &scalarLog;
+    k.fixedSize = 0;
+    return k;
+}
+
+// one output frame through the stages PsdPipeline::psd runs with numAvg 2
+// and a log
+static void frame(const PsdKernels& k, bool complex, std::vector<std::complex<float> >& fft,
+                  std::vector<float>& psd, std::vector<float>& sum)
+{
+    size_t len = fft.size();
+    for (int avg=0; avg<2; avg++) {
+        if (complex)
+            k.magnitudeShifted(&fft[0], &psd[0], len);
+        else
+            k.magnitude(&fft[0], &psd[0], len);
+        if (avg==0)
+            memcpy(&sum[0], &psd[0], len*sizeof(float));
+        else
+            k.accumulate(&sum[0], &psd[0], len);
+    }
+    k.mean(&sum[0], 0.5f, &psd[0], len);
+    k.log(&psd[0], 10.0f, len);
+}
+
+// nanoseconds per frame
+static double bench(const PsdKernels& k, bool complex, size_t len, double seconds)
+{
+    std::vector<std::complex<float> > fft(len);
+    for (size_t i=0; i<len; i++)
+        fft[i] = std::complex<float>(rand()/float(RAND_MAX), rand()/float(RAND_MAX));
+    std::vector<float> psd(len);
+    std::vector<float> sum(len);
+
+    // warm up and size the batch to roughly a tenth of the time budget
+    size_t batch = 1;
+    double start = now();
+    while (now()-start < seconds/10) {
+        for (size_t i=0; i<batch; i++)
+            frame(k, complex, fft, psd, sum);
+        batch *= 2;
+    }
+
+    size_t frames = 0;
+    start = now();
+    double elapsed;
+    do {
+        for (size_t i=0; i<batch; i++)
+            frame(k, complex, fft, psd, sum);
+        frames += batch;
+        elapsed = now()-start;
+    } while (elapsed < seconds);
+    return elapsed/frames*1e9;
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = 0.5;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:")) != -1) {
+        switch (opt) {
+        case 't':
+            seconds = atof(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t seconds per case]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const size_t sizes[] = {1024, 4096, 8192, 32768};
+    const PsdKernels reference = scalar();
+    printf("%8s %8s %12s %12s %12s %12s %12s\n", "fftSize", "input", "scalar ns", "generic ns", "fixed ns",
+           "vs scalar", "vs generic");
+    for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++) {
+        for (int complex=0; complex<2; complex++) {
+            size_t len = complex ? sizes[s] : sizes[s]/2+1;
+            const PsdKernels& fixed = PsdKernels::select(len);
+            if (!fixed.fixedSize) {
+                fprintf(stderr, "no fixed kernels for %zu bins\n", len);
+                return 1;
+            }
+            double before = bench(reference, complex, len, seconds);
+            double generic = bench(PsdKernels::generic(), complex, len, seconds);
+            double special = bench(fixed, complex, len, seconds);
+            printf("%8zu %8s %12.0f %12.0f %12.0f %11.1f%% %11.1f%%\n", sizes[s], complex ? "complex" : "real",
+                   before, generic, special, 100*(before-special)/before, 100*(generic-special)/generic);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+/**************************************************************************
+
+    Minimal reader for the psd /dev/shm frame export (see shmring.h).
+
+    Maps the ring read-only, follows the writer and prints one line per
+    frame (or writes the raw frames to a file).  Each frame and the SRI are
+    copied out and the sequence counts re-checked before anything is used,
+    so a frame overwritten while it was being read is never passed on.
+
+    usage: psd_shm_reader <ring name> [-n frames] [-o outfile] [-q]
+
+**************************************************************************/
+
+#include "../shmring.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec+tv.tv_usec*1e-6;
+}
+
+static PsdShmHeader* openRing(const char* name, size_t& bytes)
+{
+    std::string shmName = name;
+    if (shmName.empty() || shmName[0]!='/')
+        shmName = "/"+shmName;
+    int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+    if (fd<0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st)!=0 || size_t(st.st_size)<size_t(PSD_SHM_HEADER_BYTES)) {
+        close(fd);
+        return NULL;
+    }
+    bytes = st.st_size;
+    void* ptr = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr==MAP_FAILED)
+        return NULL;
+    PsdShmHeader* header = static_cast<PsdShmHeader*>(ptr);
+    if (memcmp(header->magic, PSD_SHM_MAGIC, sizeof(header->magic))!=0 || header->version!=PSD_SHM_VERSION) {
+        munmap(ptr, bytes);
+        return NULL;
+    }
+    return header;
+}
+
+struct SriCopy {
+    double xstart;
+    double xdelta;
+};
+
+//copy the SRI fields out - false if the writer kept changing them
+static bool readSRI(const PsdShmHeader* header, SriCopy& sri)
+{
+    for (int attempt=0; attempt<100; attempt++) {
+        uint64_t seq = header->sriSeq;
+        __sync_synchronize();
+        if (seq&1)
+            continue;
+        sri.xstart = header->xstart;
+        sri.xdelta = header->xdelta;
+        __sync_synchronize();
+        if (header->sriSeq==seq)
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc<2) {
+        fprintf(stderr, "usage: %s <ring name> [-n frames] [-o outfile] [-q]\n", argv[0]);
+        return 1;
+    }
+    const char* name = argv[1];
+    unsigned long maxFrames = 0;
+    const char* outName = NULL;
+    bool quiet = false;
+    for (int i=2; i<argc; i++) {
+        if (strcmp(argv[i], "-n")==0 && i+1<argc)
+            maxFrames = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-o")==0 && i+1<argc)
+            outName = argv[++i];
+        else if (strcmp(argv[i], "-q")==0)
+            quiet = true;
+    }
+
+    FILE* out = NULL;
+    if (outName) {
+        out = fopen(outName, "wb");
+        if (!out) {
+            perror(outName);
+            return 1;
+        }
+    }
+
+    size_t bytes = 0;
+    PsdShmHeader* header = NULL;
+    uint64_t next = 0;
+    unsigned long frames = 0;
+    unsigned long lost = 0;
+    double start = 0;
+    std::vector<float> data;
+
+    while (maxFrames==0 || frames<maxFrames) {
+        if (!header) {
+            header = openRing(name, bytes);
+            if (!header) {
+                usleep(100000);
+                continue;
+            }
+            //start with the newest frame rather than replaying the ring
+            next = header->writeSeq;
+            if (start==0)
+                start = now();
+        }
+        if (header->closed) {
+            munmap(header, bytes);
+            header = NULL;
+            continue;
+        }
+
+        uint64_t written = header->writeSeq;
+        if (next>=written) {
+            usleep(1000);
+            continue;
+        }
+        if (written-next>header->slotCount) {
+            lost += written-next-header->slotCount;
+            next = written-header->slotCount;
+        }
+
+        const char* base = reinterpret_cast<const char*>(header)+PSD_SHM_HEADER_BYTES;
+        const PsdShmSlot* slot = reinterpret_cast<const PsdShmSlot*>(base+(next%header->slotCount)*header->slotBytes);
+        uint64_t seq = slot->seq;
+        __sync_synchronize();
+        if (seq!=2*next+2) {
+            //overwritten (or being written) before we got to it
+            lost++;
+            next++;
+            continue;
+        }
+        //copy the frame out, then check it was not overwritten meanwhile
+        const float* slotData = reinterpret_cast<const float*>(reinterpret_cast<const char*>(slot)+PSD_SHM_SLOT_HEADER_BYTES);
+        size_t length = std::min<size_t>(slot->length, header->maxLength);
+        double twsec = slot->twsec;
+        double tfsec = slot->tfsec;
+        data.resize(length);
+        if (length>0)
+            memcpy(&data[0], slotData, length*sizeof(float));
+        SriCopy sri = {0, 0};
+        bool sriValid = quiet || readSRI(header, sri);
+
+        __sync_synchronize();
+        if (slot->seq!=seq || !sriValid) {
+            lost++;
+            next++;
+            continue;
+        }
+
+        if (out && length>0)
+            fwrite(&data[0], sizeof(float), length, out);
+        size_t peak = 0;
+        for (size_t i=1; i<length; i++) {
+            if (data[i]>data[peak])
+                peak = i;
+        }
+        float peakVal = length>0 ? data[peak] : 0.0f;
+
+        frames++;
+        if (!quiet) {
+            printf("frame %llu time %.6f len %lu peak bin %lu (%.3f) = %g\n",
+                   (unsigned long long)next, twsec+tfsec, (unsigned long)length,
+                   (unsigned long)peak, sri.xstart+peak*sri.xdelta, peakVal);
+        }
+        next++;
+    }
+
+    double elapsed = now()-start;
+    fprintf(stderr, "%lu frames, %lu lost, %.1f frames/s\n", frames, lost, elapsed>0 ? frames/elapsed : 0.0);
+    if (out)
+        fclose(out);
+    if (header)
+        munmap(header, bytes);
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+/**************************************************************************
+
+    Benchmark of the waterfall codec (see waterfallcodec.h).
+
+    Encodes a run of psd frames - a synthetic waterfall (noise floor with
+    the spread of an average of numAvg frames, a few drifting carriers and
+    a slow gain change), or psd frames read from a file of raw 32-bit
+    floats such as the replay output - then decodes them again, and prints
+    the compression ratio against 32-bit floats, the encode and decode
+    rates and the largest reconstruction error.
+
+    usage: psd_waterfall_bench [-b bins] [-n frames] [-a numAvg]
+                               [-r resolution dB] [-k keyframe interval]
+                               [-l logCoefficient of the file] [file]
+
+**************************************************************************/
+
+#include "../waterfallcodec.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <vector>
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static double uniform()
+{
+    return (rand()+1.0)/(RAND_MAX+2.0);
+}
+
+// dB frames of a waterfall with numAvg frame averaging
+static void synthesize(size_t bins, size_t frames, size_t numAvg, std::vector<float>& db)
+{
+    const size_t carriers = 8;
+    db.resize(bins*frames);
+    for (size_t f=0; f<frames; f++) {
+        double gain = 3*sin(f*0.01);
+        for (size_t i=0; i<bins; i++) {
+            // the mean of numAvg exponential (chi squared, 2 dof) bins
+            double power = 0;
+            for (size_t a=0; a<numAvg; a++)
+                power -= log(uniform());
+            power /= numAvg;
+            for (size_t c=0; c<carriers; c++) {
+                double centre = bins*(c+0.5)/carriers + 20*sin(f*0.02+c);
+                double offset = (i-centre)/(2.0+c);
+                power += 1e4*exp(-offset*offset);
+            }
+            db[f*bins+i] = 10*log10(power)+gain;
+        }
+    }
+}
+
+static bool load(const char* path, size_t bins, float logCoeff, std::vector<float>& db)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    std::vector<float> frame(bins);
+    while (fread(&frame[0], sizeof(float), bins, file)==bins) {
+        for (size_t i=0; i<bins; i++)
+            db.push_back(logCoeff>0 ? frame[i]*10/logCoeff : 10*log10(frame[i]));
+    }
+    fclose(file);
+    if (db.empty()) {
+        fprintf(stderr, "%s: no frames of %zu bins\n", path, bins);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t bins = 2048;
+    size_t frames = 1000;
+    size_t numAvg = 16;
+    float logCoeff = 0;
+    WaterfallEncoder::Settings settings;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:n:a:r:k:l:")) != -1) {
+        switch (opt) {
+        case 'b':
+            bins = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            frames = strtoul(optarg, NULL, 10);
+            break;
+        case 'a':
+            numAvg = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            settings.resolution = atof(optarg);
+            break;
+        case 'k':
+            settings.keyframeInterval = strtoul(optarg, NULL, 10);
+            break;
+        case 'l':
+            logCoeff = atof(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-b bins] [-n frames] [-a numAvg] [-r resolution dB] "
+                    "[-k keyframe interval] [-l logCoefficient of the file] [file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (bins==0 || numAvg==0) {
+        fprintf(stderr, "bins and numAvg must be at least 1\n");
+        return 1;
+    }
+
+    std::vector<float> db;
+    if (optind < argc) {
+        if (!load(argv[optind], bins, logCoeff, db))
+            return 1;
+        frames = db.size()/bins;
+    } else {
+        synthesize(bins, frames, numAvg, db);
+    }
+
+    WaterfallEncoder encoder;
+    encoder.configure(settings);
+    std::vector<unsigned char> packets;
+    packets.reserve(db.size()*sizeof(float));
+    double start = now();
+    for (size_t f=0; f<frames; f++)
+        encoder.encode(&db[f*bins], bins, packets);
+    double encodeTime = now()-start;
+
+    WaterfallDecoder decoder;
+    std::vector<float> frame;
+    double maxError = 0;
+    size_t offset = 0;
+    size_t decoded = 0;
+    double decodeTime = 0;
+    while (offset < packets.size()) {
+        size_t used;
+        start = now();
+        WaterfallDecoder::Status status = decoder.decode(&packets[offset], packets.size()-offset, frame, used);
+        decodeTime += now()-start;
+        if (status!=WaterfallDecoder::FRAME) {
+            fprintf(stderr, "packet %zu did not decode\n", decoded);
+            return 1;
+        }
+        for (size_t i=0; i<bins; i++)
+            maxError = std::max(maxError, fabs(double(frame[i])-db[decoded*bins+i]));
+        offset += used;
+        decoded++;
+    }
+
+    double rawBytes = double(frames)*bins*sizeof(float);
+    printf("%zu frames of %zu bins, resolution %g dB, keyframe every %zu frames\n",
+           frames, bins, settings.resolution, settings.keyframeInterval);
+    printf("compression ratio  %8.2f  (%.2f bits per bin)\n", rawBytes/packets.size(),
+           8.0*packets.size()/(double(frames)*bins));
+    printf("encode             %8.0f frames/s  %8.1f Mbins/s\n", frames/encodeTime, frames*bins/encodeTime/1e6);
+    printf("decode             %8.0f frames/s  %8.1f Mbins/s\n", frames/decodeTime, frames*bins/decodeTime/1e6);
+    printf("max error          %8.4f dB\n", maxError);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <set>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <boost/thread/mutex.hpp>
+
+namespace {
+    //every live StageTrace, for dump()
+    boost::mutex registryLock;
+    std::set<StageTrace*>& registry()
+    {
+        static std::set<StageTrace*> traces;
+        return traces;
+    }
+
+    void writeEscaped(FILE* file, const std::string& text)
+    {
+        for (std::string::const_iterator c=text.begin(); c!=text.end(); ++c) {
+            if (*c=='"' || *c=='\\')
+                fputc('\\', file);
+            if (static_cast<unsigned char>(*c) < 0x20)
+                fprintf(file, "\\u%04x", *c);
+            else
+                fputc(*c, file);
+        }
+    }
+}
+
+volatile bool StageTrace::enabled_ = false;
+
+StageTrace::StageTrace(const std::string& name, size_t depth) :
+    name_(name),
+    events_(NULL),
+    depth_(std::max(depth, size_t(1))),
+    head_(0),
+    tid_(0)
+{
+    boost::mutex::scoped_lock lock(registryLock);
+    registry().insert(this);
+}
+
+StageTrace::~StageTrace()
+{
+    boost::mutex::scoped_lock lock(registryLock);
+    registry().erase(this);
+    delete[] events_;
+}
+
+void StageTrace::release()
+{
+    boost::mutex::scoped_lock lock(registryLock);
+    delete[] events_;
+    events_ = NULL;
+    head_ = 0;
+}
+
+void StageTrace::setEnabled(bool enable)
+{
+    enabled_ = enable;
+}
+
+const char* StageTrace::stageName(Stage stage)
+{
+    static const char* names[NUM_STAGES] = {
+        "read", "overlap", "fft", "psd", "fft_shift", "sri", "shm", "queue", "write"
+    };
+    return stage<NUM_STAGES ? names[stage] : "unknown";
+}
+
+uint64_t StageTrace::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec)*1000000000ULL + ts.tv_nsec;
+}
+
+void StageTrace::record(Stage stage, uint64_t start, uint64_t end)
+{
+    if (!tid_)
+        tid_ = syscall(SYS_gettid);
+    if (!events_) {
+        boost::mutex::scoped_lock lock(registryLock);
+        events_ = new Event[depth_];
+    }
+    uint64_t head = head_;
+    Event& event = events_[head % depth_];
+    event.start = start;
+    event.duration = uint32_t(std::min(end-start, uint64_t(0xffffffffU)));
+    event.stage = stage;
+    //the event must be complete before a reader can see it
+    __sync_synchronize();
+    head_ = head+1;
+}
+
+void StageTrace::snapshot(std::vector<Event>& events) const
+{
+    //called with the registry locked, so the ring cannot be freed meanwhile
+    events.clear();
+    if (!events_)
+        return;
+    uint64_t depth = depth_;
+    uint64_t head = head_;
+    __sync_synchronize();
+    uint64_t first = head>depth ? head-depth : 0;
+    for (uint64_t i=first; i<head; i++)
+        events.push_back(events_[i % depth]);
+    __sync_synchronize();
+    //the writer may have overwritten (or be overwriting) the oldest events
+    //while we were copying - keep only the ones it cannot have reached
+    uint64_t after = head_;
+    uint64_t safe = after+1>depth ? after+1-depth : 0;
+    if (safe>first)
+        events.erase(events.begin(), events.begin()+std::min(size_t(safe-first), events.size()));
+}
+
+bool StageTrace::dump(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    int pid = getpid();
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    boost::mutex::scoped_lock lock(registryLock);
+    std::vector<Event> events;
+    for (std::set<StageTrace*>::iterator trace=registry().begin(); trace!=registry().end(); ++trace) {
+        long tid = (*trace)->tid_;
+        if (!tid)
+            continue;
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"",
+                first ? "" : ",\n", pid, tid);
+        writeEscaped(file, (*trace)->name_);
+        fprintf(file, "\"}}");
+        first = false;
+
+        (*trace)->snapshot(events);
+        for (size_t i=0; i<events.size(); i++) {
+            //chrome wants microseconds
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"psd\",\"ph\":\"X\",\"pid\":%d,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f}",
+                    stageName(Stage(events[i].stage)), pid, tid, events[i].start/1e3, events[i].duration/1e3);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file)==0;
+}
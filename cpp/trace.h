@@ -0,0 +1,124 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_TRACE_H
+#define PSD_TRACE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define PSD_PROBE_BEGIN(stage, stream) DTRACE_PROBE2(psd, stage_begin, stage, stream)
+#define PSD_PROBE_END(stage, stream) DTRACE_PROBE2(psd, stage_end, stage, stream)
+#else
+#define PSD_PROBE_BEGIN(stage, stream)
+#define PSD_PROBE_END(stage, stream)
+#endif
+
+class StageTrace
+{
+    //per-thread record of how long each processing stage took
+    //
+    //each processing (and sender) thread owns one StageTrace and is its only
+    //writer.  Events go into a fixed ring that never blocks; a dump copies the
+    //ring while it is being written and throws away anything that was
+    //overwritten during the copy.
+    //
+    //recording is off unless setEnabled(true).  The ring is only allocated by
+    //the owning thread's first event after tracing is enabled, and freed (with
+    //the events in it) by its first start() after tracing is disabled, so a
+    //trace that is off holds no memory and start() costs a flag test or two.
+    //The static perf/systemtap probes (psd:stage_begin and psd:stage_end, if
+    //built with sys/sdt.h) fire either way and cost a nop until attached to.
+    //
+    //usage:
+    //    uint64_t t = trace.start(StageTrace::FFT);
+    //    ... do the work ...
+    //    trace.stop(StageTrace::FFT, t);
+public:
+    enum Stage {
+        READ,
+        OVERLAP,
+        FFT,
+        PSD,
+        FFT_SHIFT,
+        SRI,
+        SHM,
+        QUEUE,
+        WRITE,
+        NUM_STAGES
+    };
+
+    explicit StageTrace(const std::string& name, size_t depth=4096);
+    ~StageTrace();
+
+    uint64_t start(Stage stage)
+    {
+        PSD_PROBE_BEGIN(int(stage), name_.c_str());
+        if (enabled_)
+            return now();
+        if (events_)
+            release();
+        return 0;
+    }
+
+    void stop(Stage stage, uint64_t startTime)
+    {
+        PSD_PROBE_END(int(stage), name_.c_str());
+        if (startTime)
+            record(stage, startTime, now());
+    }
+
+    //bytes held by the event ring
+    size_t memoryBytes() const {return events_ ? depth_*sizeof(Event) : 0;}
+
+    static void setEnabled(bool enable);
+    static bool enabled() {return enabled_;}
+
+    //write every registered trace as a Chrome/Perfetto "trace event" json
+    //file - returns false if the file could not be written
+    static bool dump(const std::string& path);
+
+    static const char* stageName(Stage stage);
+
+private:
+    struct Event {
+        uint64_t start;     // ns, CLOCK_MONOTONIC
+        uint32_t duration;  // ns
+        uint32_t stage;
+    };
+
+    static uint64_t now();
+    void record(Stage stage, uint64_t start, uint64_t end);
+    void release();
+    void snapshot(std::vector<Event>& events) const;
+
+    std::string name_;
+    //only allocated and freed by the writer, with the registry locked so a
+    //dump never sees it change
+    Event* volatile events_;
+    size_t depth_;
+    volatile uint64_t head_;    // events ever recorded
+    volatile long tid_;         // writer thread, set on first record
+
+    static volatile bool enabled_;
+};
+
+#endif
@@ -0,0 +1,254 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#include "transform.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <map>
+#include <vector>
+
+namespace {
+    //the fftw planner is not thread safe, but executing a plan through the
+    //new-array interface is, so one plan per size/type/settings serves every
+    //stream
+    boost::mutex plannerLock;
+
+    // size, complex, unaligned, frames, rigor, threads
+    typedef boost::tuple<size_t, bool, bool, size_t, unsigned, unsigned> PlanKey;
+    typedef std::map<PlanKey, fftwf_plan> PlanCache;
+    PlanCache planCache;
+
+    void initThreads()
+    {
+        //called with plannerLock held
+#ifdef HAVE_LIBFFTW3F_THREADS
+        static bool initialized = false;
+        if (!initialized)
+            initialized = fftwf_init_threads()!=0;
+#endif
+    }
+}
+
+TransformSettings::TransformSettings() :
+    rigor(FFTW_MEASURE),
+    threads(1),
+    batch(1),
+    planTimeLimit(-1)
+{
+}
+
+bool TransformSettings::operator==(const TransformSettings& other) const
+{
+    return rigor==other.rigor && threads==other.threads && batch==other.batch;
+}
+
+const char* TransformSettings::rigorName(unsigned rigor)
+{
+    switch (rigor) {
+    case FFTW_ESTIMATE: return "estimate";
+    case FFTW_MEASURE: return "measure";
+    case FFTW_PATIENT: return "patient";
+    case FFTW_EXHAUSTIVE: return "exhaustive";
+    }
+    return "unknown";
+}
+
+bool TransformSettings::parseRigor(const std::string& name, unsigned& rigor)
+{
+    if (name=="estimate")
+        rigor = FFTW_ESTIMATE;
+    else if (name=="measure")
+        rigor = FFTW_MEASURE;
+    else if (name=="patient")
+        rigor = FFTW_PATIENT;
+    else if (name=="exhaustive")
+        rigor = FFTW_EXHAUSTIVE;
+    else
+        return false;
+    return true;
+}
+
+FrameTransform::FrameTransform() :
+    fftSz_(0),
+    complex_(false),
+    alignedPlan_(NULL),
+    unalignedPlan_(NULL),
+    alignedBatch_(NULL),
+    unalignedBatch_(NULL)
+{
+}
+
+void FrameTransform::setup(size_t fftSize, bool complex, const TransformSettings& settings)
+{
+    if (alignedPlan_ && fftSize==fftSz_ && complex==complex_ && settings==settings_)
+        return;
+    fftSz_ = fftSize;
+    complex_ = complex;
+    settings_ = settings;
+    unalignedPlan_ = NULL;
+    alignedBatch_ = NULL;
+    unalignedBatch_ = NULL;
+    alignedPlan_ = plan(false, 1);
+}
+
+fftwf_plan FrameTransform::plan(bool unaligned, size_t frames)
+{
+    boost::mutex::scoped_lock lock(plannerLock);
+    PlanKey key(fftSz_, complex_, unaligned, frames, settings_.rigor, settings_.threads);
+    PlanCache::iterator cached = planCache.find(key);
+    if (cached!=planCache.end())
+        return cached->second;
+
+    //measuring overwrites the arrays, so plan on scratch arrays - the plans are
+    //only ever run through the new-array execute interface
+    unsigned flags = settings_.rigor|FFTW_PRESERVE_INPUT;
+    if (unaligned)
+        flags |= FFTW_UNALIGNED;
+    initThreads();
+#ifdef HAVE_LIBFFTW3F_THREADS
+    fftwf_plan_with_nthreads(settings_.threads);
+#endif
+    //the limit is global to fftw, so it is only ever set for this plan
+    fftwf_set_timelimit(settings_.planTimeLimit<0 ? FFTW_NO_TIMELIMIT : settings_.planTimeLimit);
+    //frames are back to back - the distances are in input and output elements
+    int n = fftSz_;
+    int inDist = fftSz_;
+    int outDist = outSize();
+    size_t inFloats = (complex_ ? 2*fftSz_ : fftSz_)*frames;
+    float* in = static_cast<float*>(fftwf_malloc(inFloats*sizeof(float)));
+    fftwf_complex* out = static_cast<fftwf_complex*>(fftwf_malloc(outSize()*frames*sizeof(fftwf_complex)));
+    fftwf_plan plan;
+    if (complex_)
+        plan = fftwf_plan_many_dft(1, &n, frames, reinterpret_cast<fftwf_complex*>(in), NULL, 1, inDist,
+                                   out, NULL, 1, outDist, FFTW_FORWARD, flags);
+    else
+        plan = fftwf_plan_many_dft_r2c(1, &n, frames, in, NULL, 1, inDist, out, NULL, 1, outDist, flags);
+    fftwf_set_timelimit(FFTW_NO_TIMELIMIT);
+    fftwf_free(in);
+    fftwf_free(out);
+    planCache[key] = plan;
+    return plan;
+}
+
+void FrameTransform::run(const float* in, std::complex<float>* out, size_t frames)
+{
+    //the new-array interface does not take const input, but with
+    //FFTW_PRESERVE_INPUT the input is only ever read
+    float* input = const_cast<float*>(in);
+    fftwf_complex* output = reinterpret_cast<fftwf_complex*>(out);
+    size_t inFloats = complex_ ? 2*fftSz_ : fftSz_;
+    size_t batch = settings_.batch;
+    while (frames>0) {
+        //every plan assumes the alignment of the arrays it was made with - a
+        //frame after an odd number of real frames has an unaligned output
+        bool unaligned = fftwf_alignment_of(input)!=0 ||
+                         fftwf_alignment_of(reinterpret_cast<float*>(output))!=0;
+        fftwf_plan plan;
+        size_t count = 1;
+        if (batch>1 && frames>=batch) {
+            fftwf_plan& batchPlan = unaligned ? unalignedBatch_ : alignedBatch_;
+            if (!batchPlan)
+                batchPlan = this->plan(unaligned, batch);
+            plan = batchPlan;
+            count = batch;
+        } else if (unaligned) {
+            if (!unalignedPlan_)
+                unalignedPlan_ = this->plan(true, 1);
+            plan = unalignedPlan_;
+        } else {
+            plan = alignedPlan_;
+        }
+        if (complex_)
+            fftwf_execute_dft(plan, reinterpret_cast<fftwf_complex*>(input), output);
+        else
+            fftwf_execute_dft_r2c(plan, input, output);
+        input += count*inFloats;
+        output += count*outSize();
+        frames -= count;
+    }
+}
+
+bool FrameTransform::importWisdom(const std::string& path)
+{
+    boost::mutex::scoped_lock lock(plannerLock);
+    return importWisdomLocked(path);
+}
+
+bool FrameTransform::exportWisdom(const std::string& path)
+{
+    boost::mutex::scoped_lock lock(plannerLock);
+    importWisdomLocked(path);
+    //written to a file of our own and renamed, so neither a reader nor
+    //another writer ever sees a partial file
+    std::string temp;
+    FILE* file = createTemp(path, temp);
+    if (!file)
+        return false;
+    fftwf_export_wisdom_to_file(file);
+    bool written = fclose(file)==0;
+    if (written && rename(temp.c_str(), path.c_str())==0)
+        return true;
+    unlink(temp.c_str());
+    return false;
+}
+
+FILE* FrameTransform::createTemp(const std::string& path, std::string& temp)
+{
+    std::vector<char> name(path.begin(), path.end());
+    const char suffix[] = ".XXXXXX";
+    name.insert(name.end(), suffix, suffix+sizeof(suffix));
+    int fd = mkstemp(&name[0]);
+    if (fd<0)
+        return NULL;
+    temp = &name[0];
+    //mkstemp makes the file private - the file it replaces is meant to be
+    //shared
+    fchmod(fd, 0644);
+    FILE* file = fdopen(fd, "w");
+    if (!file) {
+        close(fd);
+        unlink(temp.c_str());
+    }
+    return file;
+}
+
+bool FrameTransform::importWisdomLocked(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file)
+        return false;
+    bool imported = fftwf_import_wisdom_from_file(file)!=0;
+    fclose(file);
+    return imported;
+}
+
+bool FrameTransform::threadsSupported()
+{
+#ifdef HAVE_LIBFFTW3F_THREADS
+    return true;
+#else
+    return false;
+#endif
+}
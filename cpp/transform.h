@@ -0,0 +1,106 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#ifndef PSD_TRANSFORM_H
+#define PSD_TRANSFORM_H
+
+#include <complex>
+#include <cstdio>
+#include <string>
+#include <fftw3.h>
+
+struct TransformSettings
+{
+    //how the plans for one fft size are made and run - picked by the
+    //Autotuner, or the defaults: FFTW_MEASURE, one thread and one frame per
+    //execute
+    TransformSettings();
+    bool operator==(const TransformSettings& other) const;
+    bool operator!=(const TransformSettings& other) const {return !(*this==other);}
+
+    //FFTW_ESTIMATE, FFTW_MEASURE or FFTW_PATIENT
+    unsigned rigor;
+    //fftw threads per execute - more than one needs libfftw3f_threads
+    unsigned threads;
+    //whole frames transformed per execute when that many are at hand
+    size_t batch;
+    //upper bound on the time spent making each plan, in seconds - negative
+    //for no limit.  Only affects planning, so it is not compared
+    double planTimeLimit;
+
+    static const char* rigorName(unsigned rigor);
+    static bool parseRigor(const std::string& name, unsigned& rigor);
+};
+
+class FrameTransform
+{
+    //forward fft of one frame, executed directly on the caller's input
+    //
+    //unlike the fftlib classes the plans are not tied to an input vector - the
+    //input can be anywhere (a window into a ring buffer, a bulkio block or a
+    //mapped file) and is never copied or modified.  Inputs that do not have
+    //fftw's preferred simd alignment are handled by a second, unaligned plan.
+    //
+    //real input gives fftSize/2+1 bins, complex input gives fftSize bins in
+    //natural (unshifted) order
+    //
+    //plans are shared by every FrameTransform of the same size, type and
+    //settings, so a FrameTransform itself holds no memory
+public:
+    FrameTransform();
+
+    void setup(size_t fftSize, bool complex, const TransformSettings& settings=TransformSettings());
+    size_t fftSize() const {return fftSz_;}
+    bool complex() const {return complex_;}
+    size_t outSize() const {return complex_ ? fftSz_ : fftSz_/2+1;}
+
+    //in must hold frames back to back frames of fftSize samples, out must be
+    //frames*outSize() long and fftw aligned.  Whole batches go through one
+    //execute and the rest one frame at a time
+    void run(const float* in, std::complex<float>* out, size_t frames=1);
+
+    //fftw wisdom shared by every plan - lets a rigorous plan found once be
+    //remade instantly in a later run on the same host.  Exporting merges in
+    //what is already in the file, so processes sharing it keep each other's
+    //wisdom
+    static bool importWisdom(const std::string& path);
+    static bool exportWisdom(const std::string& path);
+
+    //whether plans can use more than one thread
+    static bool threadsSupported();
+
+    //a new file next to path, open for writing, to be renamed over it - temp
+    //is set to its name.  NULL (errno set) if it can not be made
+    static FILE* createTemp(const std::string& path, std::string& temp);
+
+private:
+    static bool importWisdomLocked(const std::string& path);
+
+    fftwf_plan plan(bool unaligned, size_t frames);
+
+    size_t fftSz_;
+    bool complex_;
+    TransformSettings settings_;
+    fftwf_plan alignedPlan_;
+    fftwf_plan unalignedPlan_;
+    fftwf_plan alignedBatch_;
+    fftwf_plan unalignedBatch_;
+};
+
+#endif
@@ -0,0 +1,272 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "waterfallcodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    const size_t blockSize = 32;
+
+    //keeps every quantized value (and so every residual) inside 31 bits
+    const float maxSteps = 1<<24;
+
+    inline uint32_t zigzag(int32_t value)
+    {
+        return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+    }
+
+    inline int32_t unzigzag(uint32_t value)
+    {
+        return int32_t(value >> 1) ^ -int32_t(value & 1);
+    }
+
+    inline unsigned bitWidth(uint32_t value)
+    {
+        unsigned width = 0;
+        while (value) {
+            width++;
+            value >>= 1;
+        }
+        return width;
+    }
+
+    inline int32_t quantize(float db, float scale)
+    {
+        //nan and -inf (an empty bin) go to the bottom of the range
+        float steps = db*scale;
+        if (!(steps > -maxSteps))
+            return int32_t(-maxSteps);
+        if (steps > maxSteps)
+            return int32_t(maxSteps);
+        return int32_t(lrintf(steps));
+    }
+
+    void putHeader(const PsdWaterfallHeader& header, unsigned char* out)
+    {
+        //written field by field so the packet layout does not depend on the
+        //host's struct packing (the hosts this runs on are little endian)
+        memcpy(out, header.magic, 4);
+        out[4] = header.version;
+        out[5] = header.flags;
+        memcpy(out+6, &header.blockSize, 2);
+        memcpy(out+8, &header.sequence, 4);
+        memcpy(out+12, &header.bins, 4);
+        memcpy(out+16, &header.resolution, 4);
+        memcpy(out+20, &header.payloadBytes, 4);
+    }
+
+    void getHeader(const unsigned char* in, PsdWaterfallHeader& header)
+    {
+        memcpy(header.magic, in, 4);
+        header.version = in[4];
+        header.flags = in[5];
+        memcpy(&header.blockSize, in+6, 2);
+        memcpy(&header.sequence, in+8, 4);
+        memcpy(&header.bins, in+12, 4);
+        memcpy(&header.resolution, in+16, 4);
+        memcpy(&header.payloadBytes, in+20, 4);
+    }
+
+    const size_t headerBytes = 24;
+}
+
+WaterfallEncoder::Settings::Settings() :
+    resolution(0.1f),
+    keyframeInterval(32)
+{
+}
+
+bool WaterfallEncoder::Settings::operator==(const Settings& other) const
+{
+    return resolution==other.resolution && keyframeInterval==other.keyframeInterval;
+}
+
+WaterfallEncoder::WaterfallEncoder() :
+    sinceKeyframe_(0),
+    sequence_(0),
+    keyframe_(true)
+{
+}
+
+void WaterfallEncoder::configure(const Settings& settings)
+{
+    settings_ = settings;
+    reset();
+}
+
+void WaterfallEncoder::reset()
+{
+    keyframe_ = true;
+}
+
+size_t WaterfallEncoder::memoryBytes() const
+{
+    return previous_.capacity()*sizeof(int32_t) + residuals_.capacity()*sizeof(uint32_t);
+}
+
+void WaterfallEncoder::encode(const float* db, size_t bins, std::vector<unsigned char>& out)
+{
+    bool keyframe = keyframe_ || previous_.size()!=bins || sinceKeyframe_+1>=settings_.keyframeInterval;
+    float scale = settings_.resolution>0 ? 1.0f/settings_.resolution : 1.0f;
+    previous_.resize(bins);
+    residuals_.resize(bins);
+
+    //quantize, residual against the reference and zigzag in one pass - the
+    //quantized frame becomes the next frame's reference
+    int32_t last = 0;
+    for (size_t i=0; i<bins; i++) {
+        int32_t q = quantize(db[i], scale);
+        int32_t reference = keyframe ? last : previous_[i];
+        residuals_[i] = zigzag(q-reference);
+        previous_[i] = q;
+        last = q;
+    }
+
+    //worst case every block is 32 bits wide
+    size_t start = out.size();
+    size_t blocks = (bins+blockSize-1)/blockSize;
+    out.resize(start+headerBytes+blocks+bins*4);
+    unsigned char* payload = &out[start+headerBytes];
+    unsigned char* next = payload;
+    for (size_t block=0; block<bins; block+=blockSize) {
+        size_t count = std::min(blockSize, bins-block);
+        const uint32_t* values = &residuals_[block];
+        uint32_t all = 0;
+        for (size_t i=0; i<count; i++)
+            all |= values[i];
+        unsigned width = bitWidth(all);
+        *next++ = width;
+        uint64_t bits = 0;
+        unsigned held = 0;
+        for (size_t i=0; i<count; i++) {
+            bits |= uint64_t(values[i]) << held;
+            held += width;
+            while (held >= 8) {
+                *next++ = bits & 0xff;
+                bits >>= 8;
+                held -= 8;
+            }
+        }
+        if (held)
+            *next++ = bits & 0xff;
+    }
+
+    PsdWaterfallHeader header;
+    memcpy(header.magic, PSD_WATERFALL_MAGIC, 4);
+    header.version = PSD_WATERFALL_VERSION;
+    header.flags = keyframe ? PSD_WATERFALL_KEYFRAME : 0;
+    header.blockSize = blockSize;
+    header.sequence = sequence_++;
+    header.bins = bins;
+    header.resolution = settings_.resolution>0 ? settings_.resolution : 1.0f;
+    header.payloadBytes = next-payload;
+    putHeader(header, &out[start]);
+    out.resize(start+headerBytes+header.payloadBytes);
+
+    keyframe_ = false;
+    sinceKeyframe_ = keyframe ? 0 : sinceKeyframe_+1;
+}
+
+WaterfallDecoder::WaterfallDecoder() :
+    nextSequence_(0),
+    synced_(false)
+{
+}
+
+void WaterfallDecoder::reset()
+{
+    synced_ = false;
+}
+
+WaterfallDecoder::Status WaterfallDecoder::decode(const unsigned char* data, size_t len,
+                                                  std::vector<float>& frame, size_t& used)
+{
+    used = 0;
+    if (len < headerBytes)
+        return INVALID;
+    PsdWaterfallHeader header;
+    getHeader(data, header);
+    if (memcmp(header.magic, PSD_WATERFALL_MAGIC, 4)!=0 || header.version!=PSD_WATERFALL_VERSION ||
+        header.blockSize==0 || len-headerBytes < header.payloadBytes)
+        return INVALID;
+    used = headerBytes+header.payloadBytes;
+
+    bool keyframe = header.flags & PSD_WATERFALL_KEYFRAME;
+    bool inSequence = synced_ && header.sequence==nextSequence_ && previous_.size()==header.bins;
+    nextSequence_ = header.sequence+1;
+    if (!keyframe && !inSequence) {
+        synced_ = false;
+        return NEED_KEYFRAME;
+    }
+
+    //walk the block headers first, so a packet whose bins do not fit in its
+    //payload is turned away before anything is sized by it
+    const unsigned char* payload = data+headerBytes;
+    const unsigned char* end = payload+header.payloadBytes;
+    size_t blocks = header.bins/header.blockSize + (header.bins%header.blockSize ? 1 : 0);
+    if (blocks > header.payloadBytes) {
+        synced_ = false;
+        return INVALID;
+    }
+    const unsigned char* next = payload;
+    for (size_t block=0; block<header.bins; block+=header.blockSize) {
+        size_t count = std::min(size_t(header.blockSize), header.bins-block);
+        if (next>=end) {
+            synced_ = false;
+            return INVALID;
+        }
+        unsigned width = *next++;
+        if (width>32 || size_t(end-next) < (count*width+7)/8) {
+            synced_ = false;
+            return INVALID;
+        }
+        next += (count*width+7)/8;
+    }
+
+    previous_.resize(header.bins);
+    next = payload;
+    int32_t last = 0;
+    for (size_t block=0; block<header.bins; block+=header.blockSize) {
+        size_t count = std::min(size_t(header.blockSize), header.bins-block);
+        unsigned width = *next++;
+        uint64_t mask = (uint64_t(1) << width)-1;
+        uint64_t bits = 0;
+        unsigned held = 0;
+        for (size_t i=0; i<count; i++) {
+            while (held < width) {
+                bits |= uint64_t(*next++) << held;
+                held += 8;
+            }
+            int32_t residual = unzigzag(uint32_t(bits & mask));
+            bits >>= width;
+            held -= width;
+            int32_t& q = previous_[block+i];
+            q = (keyframe ? last : q) + residual;
+            last = q;
+        }
+    }
+    synced_ = true;
+
+    frame.resize(header.bins);
+    for (size_t i=0; i<header.bins; i++)
+        frame[i] = previous_[i]*header.resolution;
+    return FRAME;
+}
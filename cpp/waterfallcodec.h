@@ -0,0 +1,123 @@
+/*
+ * This file is protected by Copyright. Please refer to the COPYRIGHT file distributed with this
+ * source distribution.
+ *
+ * This file is part of REDHAWK Basic Components psd.
+ *
+ * REDHAWK Basic Components psd is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * REDHAWK Basic Components psd is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this
+ * program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef PSD_WATERFALLCODEC_H
+#define PSD_WATERFALLCODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//Compressed psd waterfall frames, as written to waterfall_dataOctet_out
+//
+//Each psd frame becomes one self-contained packet: a PsdWaterfallHeader
+//followed by payloadBytes of packed residuals.  All fields are little endian.
+//
+//The frame is quantized to steps of resolution dB, q[i] = round(dB[i]/resolution).
+//A keyframe codes each bin against the bin before it (r[i] = q[i]-q[i-1], with
+//q[-1] = 0); any other frame codes each bin against the same bin of the frame
+//before it (r[i] = q[i]-prev[i]).  The residuals are zigzag mapped to unsigned
+//(0,-1,1,-2,... -> 0,1,2,3,...) and packed in blocks of blockSize: one byte giving
+//the bit width w of the block's largest residual, then the block's residuals at w
+//bits each, least significant bit first, padded out to a whole byte.  The last
+//block of a frame may be short.
+//
+//A decoder can start on any keyframe.  sequence counts every packet of the stream,
+//so a gap (a lost packet) means waiting for the next keyframe.
+
+#define PSD_WATERFALL_MAGIC "PSDW"
+#define PSD_WATERFALL_VERSION 1
+#define PSD_WATERFALL_KEYFRAME 0x01
+
+struct PsdWaterfallHeader {
+    char magic[4];
+    uint8_t version;
+    uint8_t flags;
+    uint16_t blockSize;
+    uint32_t sequence;
+    uint32_t bins;
+    float resolution;
+    uint32_t payloadBytes;
+};
+
+class WaterfallEncoder
+{
+    //psd frames in dB to packets - see above
+public:
+    struct Settings {
+        Settings();
+        bool operator==(const Settings& other) const;
+        bool operator!=(const Settings& other) const {return !(*this==other);}
+
+        //dB per quantization step - the decoded frame is within half of this
+        float resolution;
+        //a keyframe at least this often (frames) - 0 or 1 makes every frame a keyframe
+        size_t keyframeInterval;
+    };
+
+    WaterfallEncoder();
+
+    //new settings start with a keyframe
+    void configure(const Settings& settings);
+    const Settings& settings() const {return settings_;}
+
+    //make the next frame a keyframe
+    void reset();
+
+    //append the packet for one frame of bins dB values to out
+    void encode(const float* db, size_t bins, std::vector<unsigned char>& out);
+
+    //bytes held for the previous frame
+    size_t memoryBytes() const;
+
+private:
+    Settings settings_;
+    std::vector<int32_t> previous_;
+    std::vector<uint32_t> residuals_;
+    size_t sinceKeyframe_;
+    uint32_t sequence_;
+    bool keyframe_;
+};
+
+class WaterfallDecoder
+{
+    //packets back to dB frames
+public:
+    enum Status {
+        FRAME,          // frame decoded
+        NEED_KEYFRAME,  // delta frame with no reference - skipped until the next keyframe
+        INVALID         // not a packet this decoder understands
+    };
+
+    WaterfallDecoder();
+
+    //decode the packet at the start of data into frame (resized to the number of
+    //bins) - used is set to the packet's length whenever the header is readable,
+    //so a buffer of back to back packets can be walked even past skipped ones
+    Status decode(const unsigned char* data, size_t len, std::vector<float>& frame, size_t& used);
+
+    //forget the reference frame
+    void reset();
+
+private:
+    std::vector<int32_t> previous_;
+    uint32_t nextSequence_;
+    bool synced_;
+};
+
+#endif
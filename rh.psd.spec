@@ -37,17 +37,20 @@ License:        GPLv3+
 Source0:        %{name}-%{version}.tar.gz
 BuildRoot:      %{_tmppath}/%{name}-%{version}-%{release}-root-%(%{__id_u} -n)
 
-BuildRequires:  redhawk-devel >= 2.0
-Requires:       redhawk >= 2.0
+BuildRequires:  redhawk-devel >= 2.1
+Requires:       redhawk >= 2.1
 
 BuildRequires:  rh.dsp-devel >= 2.0
 Requires:       rh.dsp >= 2.0
 BuildRequires:  rh.fftlib-devel >= 2.0
 Requires:       rh.fftlib >= 2.0
+BuildRequires:  fftw-devel >= 3.2
+Requires:       fftw >= 3.2
+BuildRequires:  systemtap-sdt-devel
 
 # Interface requirements
-BuildRequires:  bulkioInterfaces >= 2.0
-Requires:       bulkioInterfaces >= 2.0
+BuildRequires:  bulkioInterfaces >= 2.1
+Requires:       bulkioInterfaces >= 2.1
 
 # Allow upgrades from previous package name
 Obsoletes:      psd < 2.0.0
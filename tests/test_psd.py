@@ -32,6 +32,15 @@ import scipy.fftpack
 import numpy as np
 import types
 import random
+import mmap
+import struct
+import subprocess
+import tempfile
+import json
+import socket
+import itertools
+import multiprocessing
+from bulkio import timestamp
 
 DEBUG_LEVEL=3
 
@@ -98,6 +107,93 @@ def plotFreqData(fftSize, sampleRate, pyFFT, fftOut, psdOut):
         grid(True)
         show(True)
     
+class ShmRingReader(object):
+    ''' Read-only view of a psd /dev/shm frame ring (layout documented in cpp/shmring.h) '''
+    HEADER_BYTES = 4096
+    SLOT_HEADER_BYTES = 64
+
+    def __init__(self, name):
+        self.f = open(os.path.join('/dev/shm', name), 'rb')
+        self.m = mmap.mmap(self.f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, self.version, _, self.slotCount, self.slotBytes, self.maxLength = struct.unpack_from('8s5I', self.m, 0)
+        if magic != 'RHPSDSHM':
+            raise ValueError('not a psd shared memory ring')
+
+    def close(self):
+        self.m.close()
+        self.f.close()
+
+    def closed(self):
+        return struct.unpack_from('I', self.m, 28)[0] != 0
+
+    def writeSeq(self):
+        return struct.unpack_from('Q', self.m, 32)[0]
+
+    def sri(self):
+        xstart, xdelta, ydelta, subsize, mode, xunits, yunits = struct.unpack_from('3d4i', self.m, 48)
+        return {'xstart':xstart, 'xdelta':xdelta, 'ydelta':ydelta, 'subsize':subsize, 'mode':mode}
+
+    def frame(self, n):
+        ''' Returns frame n as a numpy array, or None if it has been overwritten '''
+        offset = self.HEADER_BYTES + (n % self.slotCount)*self.slotBytes
+        seq, frame, length = struct.unpack_from('QQI', self.m, offset)
+        if seq != 2*n+2:
+            return None
+        data = np.frombuffer(self.m, dtype=np.float32, count=length, offset=offset+self.SLOT_HEADER_BYTES).copy()
+        if struct.unpack_from('Q', self.m, offset)[0] != seq:
+            return None
+        return data
+
+class WaterfallDecoder(object):
+    ''' Decoder for the waterfall_dataOctet_out packets (format documented in cpp/waterfallcodec.h) '''
+    HEADER_BYTES = 24
+
+    def __init__(self):
+        self.previous = None
+        self.nextSequence = None
+
+    def decode(self, data):
+        ''' Returns the frames in a buffer of back to back packets, skipping delta frames with no reference '''
+        data = bytearray(data)
+        frames = []
+        offset = 0
+        while offset < len(data):
+            magic, version, flags, blockSize, sequence, bins, resolution, payloadBytes = \
+                struct.unpack_from('<4sBBHIIfI', buffer(data), offset)
+            if magic != 'PSDW' or version != 1:
+                raise ValueError('not a psd waterfall packet')
+            offset += self.HEADER_BYTES
+            end = offset + payloadBytes
+            keyframe = flags & 1
+            inSequence = self.previous is not None and sequence == self.nextSequence and len(self.previous) == bins
+            self.nextSequence = sequence+1
+            if not keyframe and not inSequence:
+                self.previous = None
+                offset = end
+                continue
+            if keyframe:
+                self.previous = [0]*bins
+            last = 0
+            for block in xrange(0, bins, blockSize):
+                count = min(blockSize, bins-block)
+                width = data[offset]
+                offset += 1
+                nbytes = (count*width+7)/8
+                bits = 0
+                for n, byte in enumerate(data[offset:offset+nbytes]):
+                    bits |= byte << (8*n)
+                offset += nbytes
+                for i in xrange(count):
+                    value = (bits >> (i*width)) & ((1 << width)-1)
+                    residual = (value >> 1) ^ -(value & 1)
+                    q = (last if keyframe else self.previous[block+i]) + residual
+                    self.previous[block+i] = q
+                    last = q
+            if offset != end:
+                raise ValueError('bad packet length')
+            frames.append(np.array(self.previous)*resolution)
+        return frames
+
 class ComponentTests(ossie.utils.testing.ScaComponentTestCase):
     """Test for all component implementations in psd"""
     
@@ -919,5 +1015,870 @@ class ComponentTests(ossie.utils.testing.ScaComponentTestCase):
         
         print "*PASSED"
     
+    def testOverlap(self):
+        print "\n-------- TESTING OVERLAP --------"
+        #---------------------------------
+        # Overlapped frames are taken from the internal ring - check them
+        # against numpy for real and complex input pushed in odd sized packets
+        #---------------------------------
+        sb.start()
+        fftSize = 1024
+        overlap = 768
+        stride = fftSize-overlap
+        self.comp.fftSize = fftSize
+        self.comp.overlap = overlap
+        sample_rate = 10000.
+
+        for cxData in (False, True):
+            ID = "overlap%s" %cxData
+            nsamples = fftSize*8
+            if cxData:
+                samples = np.array([complex(random.random(), random.random()) for _ in xrange(nsamples)])
+                data = unpackCx(samples)
+            else:
+                samples = np.array([random.random() for _ in xrange(nsamples)])
+                data = samples.tolist()
+            packet = 1000
+            for start in xrange(0, len(data), packet):
+                self.src.push(data[start:start+packet], streamID=ID, sampleRate=sample_rate, complexData=cxData)
+            time.sleep(.5)
+
+            psdOut = self.psdsink.getData()
+            numFrames = (nsamples-fftSize)/stride+1
+            self.assertEqual(len(psdOut), numFrames)
+            for n in xrange(numFrames):
+                frame = samples[n*stride:n*stride+fftSize]
+                if cxData:
+                    expected = abs(np.fft.fftshift(np.fft.fft(frame)))**2
+                else:
+                    expected = abs(np.fft.rfft(frame))**2
+                self.assertEqual(len(psdOut[n]), len(expected))
+                for a, b in zip(psdOut[n], expected):
+                    self.assert_isclose(a, b, 4, 3)
+            self.fftsink.getData()
+
+        # an overlap of fftSize or more is clamped to fftSize-1 - every frame
+        # moves on by one sample
+        fftSize = 64
+        self.comp.fftSize = fftSize
+        self.comp.overlap = fftSize
+        samples = np.array([random.random() for _ in xrange(fftSize*4)])
+        self.src.push(samples.tolist(), streamID='overlapClamped', sampleRate=sample_rate, complexData=False)
+        time.sleep(.5)
+        psdOut = self.psdsink.getData()
+        self.assertEqual(len(psdOut), len(samples)-fftSize+1)
+        for n in (0, 1, len(psdOut)-1):
+            expected = abs(np.fft.rfft(samples[n:n+fftSize]))**2
+            for a, b in zip(psdOut[n], expected):
+                self.assert_isclose(a, b, 4, 3)
+        self.fftsink.getData()
+
+        print "*PASSED"
+
+    def testShmExport(self):
+        print "\n-------- TESTING SHARED MEMORY EXPORT --------"
+        #---------------------------------
+        # Start component and set fftSize
+        #---------------------------------
+        sb.start()
+        ID = "shmExport"
+        fftSize = 1024
+        numFrames = 16
+        self.comp.fftSize = fftSize
+        self.comp.shmPrefix = 'psdtest_'
+        self.comp.shmDepth = 2*numFrames
+        self.comp.shmExport = True
+
+        sample_rate = 65536.
+        t = arange(fftSize*numFrames) / sample_rate
+        data = [float(x) for x in 5.0*cos(2*pi*7000.*t)]
+
+        cxData = False
+        self.src.push(data, streamID=ID, sampleRate=sample_rate, complexData=cxData)
+        time.sleep(.5)
+
+        psdOut = self.psdsink.getData()
+        self.assertEqual(len(psdOut), numFrames)
+
+        ring = ShmRingReader('psdtest_'+ID)
+        try:
+            self.assertEqual(ring.writeSeq(), numFrames)
+            sri = ring.sri()
+            self.assertEqual(sri['subsize'], fftSize/2+1)
+            self.assertEqual(sri['mode'], 0)
+            self.assertAlmostEqual(sri['xdelta'], self.psdsink.sri().xdelta)
+            for n in xrange(numFrames):
+                shmFrame = ring.frame(n)
+                self.assertNotEqual(shmFrame, None)
+                self.assertEqual(len(shmFrame), len(psdOut[n]))
+                for a, b in zip(shmFrame, psdOut[n]):
+                    self.assert_isclose(a, b, PRECISION, NUM_PLACES)
+        finally:
+            ring.close()
+
+        # Disabling the export removes the ring
+        self.comp.shmExport = False
+        self.src.push(data[:fftSize], streamID=ID, sampleRate=sample_rate, complexData=cxData)
+        time.sleep(.5)
+        self.assertFalse(os.path.exists('/dev/shm/psdtest_'+ID))
+
+        print "*PASSED"
+
+    def testShmExportThroughput(self):
+        print "\n-------- TESTING SHARED MEMORY EXPORT THROUGHPUT --------"
+        #---------------------------------
+        # Compare frames/s seen by a shm reader with the bulkio psd port
+        #---------------------------------
+        sb.start()
+        ID = "shmThroughput"
+        fftSize = 4096
+        numFrames = 256
+        self.comp.fftSize = fftSize
+        self.comp.shmPrefix = 'psdtest_'
+        self.comp.shmDepth = numFrames
+        self.comp.shmExport = True
+
+        data = [random.random() for _ in xrange(fftSize*numFrames)]
+        start = time.time()
+        self.src.push(data, streamID=ID, sampleRate=1e6, complexData=False)
+
+        ring = None
+        shmDone = None
+        bulkioDone = None
+        bulkioFrames = 0
+        while time.time()-start < 30 and (shmDone is None or bulkioDone is None):
+            if ring is None and os.path.exists('/dev/shm/psdtest_'+ID):
+                ring = ShmRingReader('psdtest_'+ID)
+            if shmDone is None and ring is not None and ring.writeSeq() >= numFrames:
+                shmDone = time.time()
+            if bulkioDone is None:
+                bulkioFrames += len(self.psdsink.getData())
+                if bulkioFrames >= numFrames:
+                    bulkioDone = time.time()
+            time.sleep(0.001)
+
+        self.assertNotEqual(shmDone, None)
+        self.assertNotEqual(bulkioDone, None)
+        self.assertEqual(bulkioFrames, numFrames)
+        for n in xrange(numFrames):
+            self.assertNotEqual(ring.frame(n), None)
+        ring.close()
+        print 'shm: %.1f frames/s, bulkio: %.1f frames/s' %(numFrames/(shmDone-start), numFrames/(bulkioDone-start))
+
+        print "*PASSED"
+
+    def testOutputSelection(self):
+        print "\n-------- TESTING CONNECTION AWARE OUTPUT --------"
+        #---------------------------------
+        # Only the connected outputs are computed - check each combination
+        #---------------------------------
+        sb.start()
+        fftSize = 1024
+        numFrames = 4
+        self.comp.fftSize = fftSize
+        self.comp.numAvg = 2
+        sample_rate = 10000.
+
+        samples = np.array([complex(random.random(), random.random()) for _ in xrange(fftSize*numFrames)])
+        data = unpackCx(samples)
+        ffts = [np.fft.fftshift(np.fft.fft(samples[n*fftSize:(n+1)*fftSize])) for n in xrange(numFrames)]
+
+        # nothing connected - the input is dropped, including any partial average
+        self.comp.disconnect(self.psdsink)
+        self.comp.disconnect(self.fftsink)
+        self.src.push(data[:2*fftSize], streamID='select', sampleRate=sample_rate, complexData=True)
+        time.sleep(.5)
+
+        # psd only
+        self.comp.connect(self.psdsink, usesPortName='psd_dataFloat_out')
+        self.src.push(data, streamID='select', sampleRate=sample_rate, complexData=True)
+        time.sleep(.5)
+        psdOut = self.psdsink.getData()
+        self.assertEqual(len(psdOut), numFrames/2)
+        for n in xrange(numFrames/2):
+            expected = (abs(ffts[2*n])**2+abs(ffts[2*n+1])**2)/2
+            for a, b in zip(psdOut[n], expected):
+                self.assert_isclose(a, b, 4, 3)
+        self.assertEqual(self.psdsink.sri().subsize, fftSize)
+        self.assertEqual(len(self.fftsink.getData()), 0)
+
+        # fft only
+        self.comp.disconnect(self.psdsink)
+        self.comp.connect(self.fftsink, usesPortName='fft_dataFloat_out')
+        self.src.push(data, streamID='select', sampleRate=sample_rate, complexData=True)
+        time.sleep(.5)
+        fftOut = self.fftsink.getData()
+        self.assertEqual(len(fftOut), numFrames)
+        for n in xrange(numFrames):
+            for re, im, b in zip(fftOut[n][::2], fftOut[n][1::2], ffts[n]):
+                self.assert_isclose(re, b.real, 4, 3)
+                self.assert_isclose(im, b.imag, 4, 3)
+        self.assertEqual(self.fftsink.sri().subsize, fftSize)
+
+        print "*PASSED"
+
+    def testPsdPooling(self):
+        print "\n-------- TESTING PSD BIN POOLING --------"
+        #---------------------------------
+        # The averaged psd is pooled down to psdWidth bins before the log,
+        # the psd sri describes the pooled bins and the fft keeps every bin
+        #---------------------------------
+        sb.start()
+        fftSize = 4096
+        width = 100
+        self.comp.fftSize = fftSize
+        self.comp.numAvg = 2
+        self.comp.logCoefficient = 10
+        self.comp.psdWidth = width
+        sample_rate = 10000.
+
+        samples = np.array([complex(random.random(), random.random()) for _ in xrange(2*fftSize)])
+        data = unpackCx(samples)
+        psd = sum(abs(np.fft.fftshift(np.fft.fft(samples[n*fftSize:(n+1)*fftSize])))**2 for n in xrange(2))/2
+        edges = [i*fftSize/width for i in xrange(width+1)]
+
+        for pooling, combine in (('mean', np.mean), ('max', np.max)):
+            self.comp.psdPooling = pooling
+            self.src.push(data, streamID='pool', sampleRate=sample_rate, complexData=True)
+            time.sleep(.5)
+            psdOut = self.psdsink.getData()
+            self.assertEqual(len(psdOut), 1)
+            self.assertEqual(len(psdOut[0]), width)
+            expected = [10*np.log10(combine(psd[edges[i]:edges[i+1]])) for i in xrange(width)]
+            for a, b in zip(psdOut[0], expected):
+                self.assert_isclose(a, b, 4, 3)
+
+            fftOut = self.fftsink.getData()
+            self.assertEqual(len(fftOut), 2)
+            self.assertEqual(len(fftOut[0]), 2*fftSize)
+
+            xdelta = sample_rate/fftSize
+            sri = self.psdsink.sri()
+            self.assertEqual(sri.subsize, width)
+            self.assertAlmostEqual(sri.xdelta, xdelta*fftSize/width)
+            self.assertAlmostEqual(sri.xstart, -xdelta*(fftSize/2-1) + xdelta*(float(fftSize)/width-1)/2)
+            self.assertEqual(self.fftsink.sri().subsize, fftSize)
+            self.assertAlmostEqual(self.fftsink.sri().xdelta, xdelta)
+
+        print "*PASSED"
+
+    def testWaterfall(self):
+        print "\n-------- TESTING COMPRESSED WATERFALL OUTPUT --------"
+        #---------------------------------
+        # The waterfall port carries the psd in dB, quantized to
+        # waterfallResolution and delta coded with periodic keyframes
+        #---------------------------------
+        sb.start()
+        fftSize = 1024
+        numFrames = 10
+        resolution = 0.25
+        self.comp.fftSize = fftSize
+        self.comp.waterfallResolution = resolution
+        self.comp.waterfallKeyframeInterval = 4
+        self.comp.disconnect(self.psdsink)
+        waterfallsink = sb.DataSink()
+        self.comp.connect(waterfallsink, usesPortName='waterfall_dataOctet_out')
+        sample_rate = 10000.
+
+        samples = np.array([complex(random.random(), random.random()) for _ in xrange(fftSize*numFrames)])
+        data = unpackCx(samples)
+        psds = [abs(np.fft.fftshift(np.fft.fft(samples[n*fftSize:(n+1)*fftSize])))**2 for n in xrange(numFrames)]
+
+        # the codec works in dB whatever the psd output scale is
+        for logCoeff in (0, 20):
+            self.comp.logCoefficient = logCoeff
+            self.src.push(data, streamID='waterfall', sampleRate=sample_rate, complexData=True)
+            time.sleep(.5)
+            frames = WaterfallDecoder().decode(waterfallsink.getData())
+            self.assertEqual(len(frames), numFrames)
+            for frame, psd in zip(frames, psds):
+                self.assertEqual(len(frame), fftSize)
+                error = abs(frame - 10*np.log10(psd))
+                self.assertTrue(max(error) <= resolution/2 + 1e-3, 'waterfall error %g dB' % max(error))
+
+        # a consumer connected mid-stream starts on a keyframe
+        latesink = sb.DataSink()
+        self.comp.connect(latesink, usesPortName='waterfall_dataOctet_out')
+        self.src.push(data, streamID='waterfall', sampleRate=sample_rate, complexData=True)
+        time.sleep(.5)
+        packets = latesink.getData()
+        self.assertTrue(bytearray(packets[:WaterfallDecoder.HEADER_BYTES])[5] & 1,
+                        'first packet of a new connection is not a keyframe')
+        self.assertEqual(len(WaterfallDecoder().decode(packets)), numFrames)
+
+        # the psd itself is not computed for output when only the waterfall is connected
+        self.assertEqual(len(self.psdsink.getData()), 0)
+        sri = waterfallsink.sri()
+        keywords = dict((kw.id, kw.value.value()) for kw in sri.keywords)
+        self.assertEqual(keywords['WATERFALL_CODEC'], 'PSDW')
+        self.assertEqual(keywords['WATERFALL_BINS'], fftSize)
+        self.assertAlmostEqual(keywords['WATERFALL_XDELTA'], sample_rate/fftSize)
+
+        print "*PASSED"
+
+    def testCrossSpectra(self):
+        print "\n-------- TESTING CROSS SPECTRA --------"
+        #---------------------------------
+        # Frames of a stream pair are matched by timestamp, and the averaged
+        # cross spectral density and coherence go out on their own port -
+        # the paired streams' ffts are kept with nothing on the fft output
+        #---------------------------------
+        sb.start()
+        fftSize = 512
+        numAvg = 8
+        numFrames = 16
+        bins = fftSize/2+1
+        self.comp.fftSize = fftSize
+        self.comp.crossSpectrumAvg = numAvg
+        self.comp.crossSpectrumPairs = [{'crossSpectrumPairs::streamA': 'chanA', 'crossSpectrumPairs::streamB': 'chanB'}]
+        self.comp.disconnect(self.fftsink)
+        csdsink = sb.DataSink()
+        self.comp.connect(csdsink, usesPortName='csd_dataFloat_out')
+        sample_rate = 10000.
+
+        # b is partly a, so the coherence is well away from both 0 and 1
+        nsamples = fftSize*numFrames
+        a = np.array([random.random()-0.5 for _ in xrange(nsamples)])
+        b = 0.5*a + np.array([random.random()-0.5 for _ in xrange(nsamples)])
+        start = timestamp.create(1500000000, 0.0)
+        for ID, samples in (('chanA', a), ('chanB', b)):
+            self.src.push(samples.tolist(), streamID=ID, sampleRate=sample_rate, complexData=False, ts=start)
+        time.sleep(.5)
+
+        self.assertEqual(len(self.psdsink.getData()), 2*numFrames)
+        frames = csdsink.getData()
+        csds = [np.array(f[0::2]) + 1j*np.array(f[1::2]) for f in frames if len(f)==2*bins]
+        coherences = [f for f in frames if len(f)==bins]
+        self.assertEqual(len(csds), numFrames/numAvg)
+        self.assertEqual(len(coherences), numFrames/numAvg)
+        for n in xrange(numFrames/numAvg):
+            frameRange = xrange(n*numAvg, (n+1)*numAvg)
+            A = [np.fft.rfft(a[f*fftSize:(f+1)*fftSize]) for f in frameRange]
+            B = [np.fft.rfft(b[f*fftSize:(f+1)*fftSize]) for f in frameRange]
+            sab = sum(x*np.conj(y) for x, y in zip(A, B))
+            saa = sum(abs(x)**2 for x in A)
+            sbb = sum(abs(y)**2 for y in B)
+            for x, y in zip(csds[n], sab/numAvg):
+                self.assert_isclose(x.real, y.real, 4, 3)
+                self.assert_isclose(x.imag, y.imag, 4, 3)
+            for x, y in zip(coherences[n], abs(sab)**2/(saa*sbb)):
+                self.assert_isclose(x, y, 3, 3)
+
+        keywords = dict((kw.id, kw.value.value()) for kw in csdsink.sri().keywords)
+        self.assertEqual(keywords['CSD_STREAM_A'], 'chanA')
+        self.assertEqual(keywords['CSD_STREAM_B'], 'chanB')
+        self.assertAlmostEqual(csdsink.sri().xdelta, sample_rate/fftSize)
+
+        print "*PASSED"
+
+    def testOutputBuffers(self):
+        print "\n-------- TESTING POOLED OUTPUT BUFFERS --------"
+        #---------------------------------
+        # Output frames are computed into pooled shared buffers - once the
+        # frames in flight are covered no more are allocated, and the pool
+        # stays within a few frames per core
+        #---------------------------------
+        sb.start()
+        fftSize = 1024
+        self.comp.fftSize = fftSize
+        sample_rate = 10000.
+        data = [random.random() for _ in xrange(fftSize*20)]
+
+        self.src.push(data, streamID='pool', sampleRate=sample_rate)
+        time.sleep(.5)
+        self.assertEqual(len(self.psdsink.getData()), 20)
+        allocations = self.comp.outputBufferAllocations
+        self.assertTrue(allocations > 0)
+
+        for _ in xrange(10):
+            self.src.push(data, streamID='pool', sampleRate=sample_rate)
+            time.sleep(.2)
+        time.sleep(.5)
+        psdOut = self.psdsink.getData()
+        self.assertEqual(len(psdOut), 200)
+        self.assertEqual(len(psdOut[0]), fftSize/2+1)
+        self.assertEqual(len(self.fftsink.getData()), 200)
+        self.assertEqual(self.comp.outputBufferAllocations, allocations)
+
+        # plus a batch of 4 on the shared free list and in each of the
+        # processing and sender threads' own caches
+        bins = fftSize/2+1
+        frameBytes = bins*4 + bins*8
+        self.assertTrue(self.comp.outputBufferMemory <= (max(multiprocessing.cpu_count(), self.comp.outputQueueDepth+1)+3*4)*frameBytes)
+
+        print "*PASSED"
+
+    def testOutputQueue(self):
+        print "\n-------- TESTING OUTPUT QUEUE --------"
+        #---------------------------------
+        # Outputs go through a per-stream queue - with the block policy nothing
+        # is lost even with a single entry, and the sri still leads its frames
+        #---------------------------------
+        sb.start()
+        fftSize = 512
+        numFrames = 64
+        self.comp.fftSize = fftSize
+        self.comp.outputQueueDepth = 1
+        self.comp.outputQueuePolicy = 'block'
+        sample_rate = 10000.
+
+        data = [random.random() for _ in xrange(fftSize*numFrames)]
+        self.src.push(data, streamID='queue', sampleRate=sample_rate, complexData=False)
+        time.sleep(1.0)
+        self.assertEqual(len(self.psdsink.getData()), numFrames)
+        self.assertEqual(len(self.fftsink.getData()), numFrames)
+        self.validateSRIPushing('queue', False, sample_rate, fftSize)
+
+        status = self.streamStatus()['queue']
+        self.assertEqual(status['queueDepth'], 0)
+        self.assertEqual(status['droppedFrames'], 0)
+
+        # a new sri is applied to the frames queued after it
+        self.comp.outputQueuePolicy = 'drop_oldest'
+        self.src.push(data[:fftSize], streamID='queue', sampleRate=2*sample_rate, complexData=False)
+        time.sleep(.5)
+        self.assertEqual(len(self.psdsink.getData()), 1)
+        self.validateSRIPushing('queue', False, 2*sample_rate, fftSize)
+
+        print "*PASSED"
+
+    def testPlacement(self):
+        print "\n-------- TESTING THREAD PLACEMENT --------"
+        #---------------------------------
+        # Pinned, locked processing gives the same output, and a cpu list
+        # change is picked up by running streams
+        #---------------------------------
+        sb.start()
+        fftSize = 1024
+        self.comp.fftSize = fftSize
+        self.comp.cpuAffinity = '0'
+        self.comp.lockMemory = True
+        sample_rate = 10000.
+
+        samples = np.array([random.random() for _ in xrange(fftSize)])
+        expected = abs(np.fft.rfft(samples))**2
+        for cpus in ('0', '0-%d' %(os.sysconf('SC_NPROCESSORS_ONLN')-1), ''):
+            self.comp.cpuAffinity = cpus
+            self.src.push(samples.tolist(), streamID='placement', sampleRate=sample_rate, complexData=False)
+            time.sleep(.5)
+            psdOut = self.psdsink.getData()
+            self.assertEqual(len(psdOut), 1)
+            for a, b in zip(psdOut[0], expected):
+                self.assert_isclose(a, b, 4, 3)
+
+        print "*PASSED"
+
+    def testTrace(self):
+        print "\n-------- TESTING STAGE TRACE --------"
+        #---------------------------------
+        # Record stage timing and dump it as a chrome trace
+        #---------------------------------
+        sb.start()
+        fftSize = 1024
+        numFrames = 8
+        self.comp.fftSize = fftSize
+        self.comp.overlap = fftSize/2
+        self.comp.traceEnabled = True
+
+        data = [random.random() for _ in xrange(fftSize*numFrames)]
+        self.src.push(data, streamID='trace', sampleRate=10000., complexData=False)
+        time.sleep(.5)
+        self.psdsink.getData()
+
+        fd, path = tempfile.mkstemp(suffix='.json')
+        os.close(fd)
+        try:
+            self.comp.traceFile = path
+            trace = json.load(open(path))
+        finally:
+            os.remove(path)
+
+        events = trace['traceEvents']
+        threads = [e['args']['name'] for e in events if e['ph'] == 'M']
+        self.assertTrue('psd trace' in threads)
+        self.assertTrue('psd sender trace' in threads)
+        stages = set(e['name'] for e in events if e['ph'] == 'X')
+        for stage in ('read', 'overlap', 'fft', 'psd', 'fft_shift', 'sri', 'queue', 'write'):
+            self.assertTrue(stage in stages, stage)
+        ffts = [e for e in events if e['name'] == 'fft']
+        self.assertEqual(len(ffts), 2*numFrames-1)
+        for e in ffts:
+            self.assertTrue(e['dur'] >= 0)
+
+        print "*PASSED"
+
+    def streamStatus(self):
+        status = {}
+        for s in self.comp.streamStatus.queryValue():
+            s = dict((k.split('::')[-1], v) for k, v in s.items())
+            status[s['streamID']] = s
+        return status
+
+    def testIdleRelease(self):
+        print "\n-------- TESTING IDLE STREAM RELEASE --------"
+        #---------------------------------
+        # Per stream memory is only the overlap history and the averaging sum,
+        # and idle streams give even that back after idleTimeout
+        #---------------------------------
+        sb.start()
+        fftSize = 4096
+        numStreams = 8
+        self.comp.fftSize = fftSize
+        self.comp.overlap = fftSize/2
+        self.comp.numAvg = 4
+
+        data = [random.random() for _ in xrange(fftSize*2)]
+        for n in xrange(numStreams):
+            self.src.push(data, streamID='idle%d' %n, sampleRate=1e6, complexData=False)
+        time.sleep(.5)
+
+        status = self.streamStatus()
+        self.assertEqual(len(status), numStreams)
+        for s in status.values():
+            self.assertTrue(s['memoryBytes'] > 0)
+            self.assertFalse(s['idle'])
+        # the working buffers are shared and handed back once the streams run
+        # dry, so a quiet component is left with one arena (each buffer is on
+        # whole pages) whatever the stream count
+        def pages(nbytes):
+            return -(-nbytes//mmap.PAGESIZE)*mmap.PAGESIZE
+        arenaBytes = pages((fftSize/2+1)*8)+pages((fftSize/2+1)*4)+pages(fftSize*4)
+        time.sleep(.5)
+        self.assertTrue(self.comp.scratchMemory <= 2*arenaBytes)
+
+        self.comp.idleTimeout = 0.2
+        time.sleep(1.0)
+        status = self.streamStatus()
+        for s in status.values():
+            self.assertEqual(s['memoryBytes'], 0)
+            self.assertTrue(s['idle'])
+
+        # the partial average was dropped - a stream starts over when data comes back
+        self.psdsink.getData()
+        self.src.push(data*2, streamID='idle0', sampleRate=1e6, complexData=False)
+        time.sleep(.5)
+        self.assertEqual(len(self.psdsink.getData()), 1)
+        self.assertFalse(self.streamStatus()['idle0']['idle'])
+
+        print "*PASSED"
+
+    def testConfigChanges(self):
+        print "\n-------- TESTING SETTINGS CHANGES ACROSS STREAMS --------"
+        #---------------------------------
+        # Settings are published to every running stream at once - each
+        # change applies to all the streams' next frames
+        #---------------------------------
+        sb.start()
+        numStreams = 8
+        sample_rate = 10000.
+        samples = np.array([random.random() for _ in xrange(2048)])
+
+        for fftSize, numAvg, logCoeff in ((512, 0, 0), (1024, 2, 10), (256, 0, 20), (1024, 0, 0)):
+            self.comp.fftSize = fftSize
+            self.comp.numAvg = numAvg
+            self.comp.logCoefficient = logCoeff
+            frames = max(numAvg, 1)
+            for n in xrange(numStreams):
+                self.src.push(samples[:fftSize*frames].tolist(), streamID='config%d' %n,
+                              sampleRate=sample_rate, complexData=False)
+            time.sleep(.5)
+
+            psd = sum(abs(np.fft.rfft(samples[f*fftSize:(f+1)*fftSize]))**2 for f in xrange(frames))/frames
+            if logCoeff > 0:
+                psd = logCoeff*np.log10(psd)
+            psdOut = self.psdsink.getData()
+            self.assertEqual(len(psdOut), numStreams)
+            for frame in psdOut:
+                self.assertEqual(len(frame), fftSize/2+1)
+                for a, b in zip(frame, psd):
+                    self.assert_isclose(a, b, 4, 3)
+            self.assertEqual(self.psdsink.sri().subsize, fftSize/2+1)
+            self.fftsink.getData()
+
+        print "*PASSED"
+
+    def transformConfig(self, mode):
+        for entry in self.comp.transformConfig.queryValue():
+            config = dict((k.split('::')[-1], v) for k, v in entry.items())
+            if config['mode'] == mode:
+                return config
+        self.fail('no transformConfig for %s input' % mode)
+
+    def testAutotune(self):
+        print "\n-------- TESTING FFT AUTOTUNE --------"
+        #---------------------------------
+        # The autotuner picks the fft settings for each fftSize within its
+        # budget and caches them per host - whatever it picks, the psd is
+        # the same
+        #---------------------------------
+        sb.start()
+        fftSize = 1024
+        numFrames = 64
+        self.comp.fftSize = fftSize
+        sample_rate = 10000.
+        for mode in ('real', 'complex'):
+            self.assertEqual(self.transformConfig(mode)['source'], 'default')
+
+        tmpdir = tempfile.mkdtemp()
+        cache = os.path.join(tmpdir, 'autotune')
+        try:
+            self.comp.autotuneCache = cache
+            self.comp.autotuneBudget = 0.5
+            start = time.time()
+            self.comp.autotune = True
+            self.assertTrue(time.time()-start < 5)
+            # real and complex input are tuned separately
+            configs = {}
+            for mode in ('real', 'complex'):
+                config = self.transformConfig(mode)
+                self.assertEqual(config['source'], 'autotuned')
+                self.assertTrue(config['planRigor'] in ('estimate', 'measure', 'patient'))
+                self.assertTrue(config['fftwThreads'] >= 1)
+                self.assertTrue(config['batchFrames'] >= 1)
+                self.assertTrue(config['nsPerFrame'] > 0)
+                configs[mode] = config
+            lines = [line.split() for line in open(cache)]
+            self.assertEqual(sorted((int(line[1]), line[2]) for line in lines),
+                             [(fftSize, 'complex'), (fftSize, 'real')])
+
+            # queued frames may be transformed together
+            samples = np.array([random.random() for _ in xrange(fftSize*numFrames)])
+            self.src.push(samples.tolist(), streamID='autotune', sampleRate=sample_rate, complexData=False)
+            time.sleep(.5)
+            psdOut = self.psdsink.getData()
+            self.assertEqual(len(psdOut), numFrames)
+            for n in xrange(numFrames):
+                expected = abs(np.fft.rfft(samples[n*fftSize:(n+1)*fftSize]))**2
+                for a, b in zip(psdOut[n], expected):
+                    self.assert_isclose(a, b, 4, 3)
+            self.fftsink.getData()
+
+            # the second time round the choice comes from the cache
+            self.comp.autotune = False
+            self.assertEqual(self.transformConfig('real')['source'], 'default')
+            self.comp.autotune = True
+            for mode in ('real', 'complex'):
+                cached = self.transformConfig(mode)
+                self.assertEqual(cached['source'], 'cached')
+                for key in ('planRigor', 'fftwThreads', 'batchFrames'):
+                    self.assertEqual(cached[key], configs[mode][key])
+
+            # each fftSize is tuned on its own
+            self.comp.fftSize = 2048
+            self.assertEqual(self.transformConfig('real')['source'], 'autotuned')
+            lines = [line.split() for line in open(cache)]
+            self.assertEqual(sorted(int(line[1]) for line in lines), [fftSize, fftSize, 2048, 2048])
+            # the files are replaced whole, never left half written
+            self.assertEqual(sorted(os.listdir(tmpdir)), ['autotune', 'autotune.wisdom'])
+        finally:
+            self.comp.autotune = False
+            for f in (cache, cache+'.wisdom'):
+                if os.path.exists(f):
+                    os.remove(f)
+            os.rmdir(tmpdir)
+
+        print "*PASSED"
+
+    def testReplay(self):
+        print "\n-------- TESTING OFFLINE REPLAY --------"
+        #---------------------------------
+        # Run psd --replay over a raw file and compare with numpy
+        #---------------------------------
+        fftSize = 1024
+        overlap = 256
+        numAvg = 3
+        stride = fftSize-overlap
+        data = np.array([random.random() for _ in xrange(fftSize*64)], dtype=np.float32)
+
+        tmpdir = tempfile.mkdtemp()
+        inFile = os.path.join(tmpdir, 'in.raw')
+        outFile = os.path.join(tmpdir, 'out.raw')
+        data.tofile(inFile)
+        try:
+            proc = subprocess.Popen(['../cpp/psd', '--replay', '--fftSize', str(fftSize), '--overlap', str(overlap),
+                                     '--numAvg', str(numAvg), '--logCoefficient', '10', '--threads', '4', inFile, outFile],
+                                    stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            stdout, stderr = proc.communicate()
+            print stdout
+            self.assertEqual(proc.returncode, 0, stderr)
+            self.assertTrue('frames/s' in stdout)
+            psdOut = np.fromfile(outFile, dtype=np.float32).reshape(-1, fftSize/2+1)
+        finally:
+            for f in (inFile, outFile):
+                if os.path.exists(f):
+                    os.remove(f)
+            os.rmdir(tmpdir)
+
+        numFrames = (len(data)-fftSize)/stride+1
+        numOut = numFrames/numAvg
+        self.assertEqual(len(psdOut), numOut)
+        for n in xrange(numOut):
+            frames = [abs(np.fft.rfft(data[f*stride:f*stride+fftSize]))**2 for f in xrange(n*numAvg, (n+1)*numAvg)]
+            expected = 10*np.log10(np.mean(frames, axis=0))
+            for a, b in zip(psdOut[n], expected):
+                self.assertAlmostEqual(a, b, 3)
+
+        print "*PASSED"
+
+class BenchmarkTests(ossie.utils.testing.ScaComponentTestCase):
+    """Throughput and latency regression suite
+
+    Each case pushes a fixed amount of data through the component in the sandbox and measures
+    the sustained input rate (samples/s) and the push-to-output latency of a single frame.
+    Results are compared against the baseline file - a case fails if its throughput falls more
+    than the tolerance below the baseline, or its latency rises more than the latency tolerance
+    above it.  Baselines are per host, since they depend on the CPU.
+
+    Environment:
+        PSD_BENCHMARK_BASELINE   baseline file (default benchmark_baseline.json next to this file)
+        PSD_BENCHMARK_TOLERANCE  allowed fractional throughput drop (default 0.25)
+        PSD_BENCHMARK_LATENCY_TOLERANCE  allowed fractional latency rise (default 0.5)
+        PSD_BENCHMARK_UPDATE     if set, record the results as the new baseline for this host
+        PSD_BENCHMARK_FULL       if set, sweep every combination instead of one parameter at a time
+    """
+
+    BASELINE_FILE = os.environ.get('PSD_BENCHMARK_BASELINE',
+                                   os.path.join(os.path.dirname(os.path.abspath(__file__)), 'benchmark_baseline.json'))
+    TOLERANCE = float(os.environ.get('PSD_BENCHMARK_TOLERANCE', '0.25'))
+    LATENCY_TOLERANCE = float(os.environ.get('PSD_BENCHMARK_LATENCY_TOLERANCE', '0.5'))
+    # sub-millisecond latencies are mostly sandbox and polling jitter
+    LATENCY_SLACK = 0.002
+    FRAMES_PER_STREAM = 64
+    PACKET_SIZE = 65536
+
+    def setUp(self):
+        ossie.utils.testing.ScaComponentTestCase.setUp(self)
+        self.src = sb.DataSource()
+        self.psdsink = sb.DataSink()
+        self.comp = sb.launch('../psd.spd.xml',execparams={'DEBUG_LEVEL':DEBUG_LEVEL})
+        self.src.connect(self.comp)
+        self.comp.connect(self.psdsink, usesPortName='psd_dataFloat_out')
+
+    def tearDown(self):
+        sb.stop()
+        self.comp.releaseObject()
+        ossie.utils.testing.ScaComponentTestCase.tearDown(self)
+
+    @staticmethod
+    def caseName(fftSize, overlap, numAvg, logCoeff, cxData, streams):
+        return 'fft%d_ovl%d_avg%d_log%d_%s_x%d' %(fftSize, overlap, numAvg, logCoeff, 'cx' if cxData else 'real', streams)
+
+    def waitForFrames(self, count, timeout):
+        ''' Drain the psd sink until count frames have arrived; returns the arrival time of the last one '''
+        received = 0
+        end = time.time()+timeout
+        while received < count and time.time() < end:
+            frames = self.psdsink.getData()
+            if frames:
+                received += len(frames)
+            else:
+                time.sleep(0.0005)
+        self.assertEqual(received, count, 'timed out waiting for psd output (%d of %d frames)' %(received, count))
+        return time.time()
+
+    def runCase(self, fftSize, overlap, numAvg, logCoeff, cxData, streams):
+        name = self.caseName(fftSize, overlap, numAvg, logCoeff, cxData, streams)
+        print "\n-------- BENCHMARK %s --------" %name
+        self.comp.fftSize = fftSize
+        self.comp.overlap = overlap
+        self.comp.numAvg = numAvg
+        self.comp.logCoefficient = logCoeff
+        sb.start()
+
+        stride = fftSize-overlap
+        framesPerOutput = max(numAvg, 1)
+        floatsPerSample = 2 if cxData else 1
+        def samplesFor(outputs):
+            # input samples that produce exactly this many psd frames
+            return fftSize+(outputs*framesPerOutput-1)*stride
+
+        nsamples = samplesFor(self.FRAMES_PER_STREAM)
+        floats = nsamples*floatsPerSample
+        data = np.random.random(floats).astype(np.float32).tolist()
+        packet = self.PACKET_SIZE - self.PACKET_SIZE%floatsPerSample
+
+        # Warm up - the first frame of a new fft size pays for fft planning
+        for i in xrange(streams):
+            self.src.push(data[:samplesFor(1)*floatsPerSample], streamID='warmup%d' %i, sampleRate=1e6, complexData=cxData, EOS=True)
+        self.waitForFrames(streams, 60)
+
+        # Sustained throughput
+        streamIDs = ['bench%d' %i for i in xrange(streams)]
+        start = time.time()
+        for offset in xrange(0, floats, packet):
+            for ID in streamIDs:
+                self.src.push(data[offset:offset+packet], streamID=ID, sampleRate=1e6, complexData=cxData)
+        done = self.waitForFrames(streams*self.FRAMES_PER_STREAM, 120)
+        samplesPerSec = streams*nsamples/(done-start)
+
+        # Push-to-output latency of a single psd frame, each on a fresh stream
+        latencies = []
+        frame = data[:samplesFor(1)*floatsPerSample]
+        for i in xrange(5):
+            pushed = time.time()
+            self.src.push(frame, streamID='latency%d' %i, sampleRate=1e6, complexData=cxData, EOS=True)
+            latencies.append(self.waitForFrames(1, 30)-pushed)
+        latency = sorted(latencies)[len(latencies)/2]
+
+        print '%s: %.3g samples/s, latency %.2f ms' %(name, samplesPerSec, latency*1e3)
+        self.checkBaseline(name, samplesPerSec, latency)
+
+    def checkBaseline(self, name, samplesPerSec, latency):
+        host = socket.gethostname()
+        baseline = {}
+        if os.path.exists(self.BASELINE_FILE):
+            with open(self.BASELINE_FILE) as f:
+                baseline = json.load(f)
+
+        if os.environ.get('PSD_BENCHMARK_UPDATE'):
+            baseline.setdefault(host, {})[name] = {'samples_per_sec':samplesPerSec, 'latency_sec':latency}
+            with open(self.BASELINE_FILE, 'w') as f:
+                json.dump(baseline, f, indent=2, sort_keys=True)
+            return
+
+        expected = baseline.get(host, {}).get(name)
+        if expected is None:
+            self.skipTest('no baseline for %s on %s - run with PSD_BENCHMARK_UPDATE=1 to record one' %(name, host))
+        floor = expected['samples_per_sec']*(1.0-self.TOLERANCE)
+        print 'baseline %.3g samples/s, latency %.2f ms' %(expected['samples_per_sec'], expected['latency_sec']*1e3)
+        self.assertTrue(samplesPerSec >= floor,
+                        '%s throughput %.3g samples/s is below %.3g (baseline %.3g, tolerance %d%%)'
+                        %(name, samplesPerSec, floor, expected['samples_per_sec'], self.TOLERANCE*100))
+        ceiling = expected['latency_sec']*(1.0+self.LATENCY_TOLERANCE)+self.LATENCY_SLACK
+        self.assertTrue(latency <= ceiling,
+                        '%s latency %.2f ms is above %.2f ms (baseline %.2f ms, tolerance %d%%)'
+                        %(name, latency*1e3, ceiling*1e3, expected['latency_sec']*1e3, self.LATENCY_TOLERANCE*100))
+
+def _addBenchmarkCases():
+    sweep = {'fftSize':[1024, 4096, 32768],
+             'overlap':[0, 50, 75],     # percent of fftSize
+             'numAvg':[0, 8],
+             'logCoeff':[0, 10],
+             'cxData':[False, True],
+             'streams':[1, 4]}
+    keys = ['fftSize', 'overlap', 'numAvg', 'logCoeff', 'cxData', 'streams']
+    base = {'fftSize':4096, 'overlap':0, 'numAvg':0, 'logCoeff':0, 'cxData':False, 'streams':1}
+    if os.environ.get('PSD_BENCHMARK_FULL'):
+        cases = [dict(zip(keys, values)) for values in itertools.product(*[sweep[k] for k in keys])]
+    else:
+        # vary one parameter at a time around the base case
+        cases = [dict(base)]
+        for key in keys:
+            for value in sweep[key]:
+                if value != base[key]:
+                    case = dict(base)
+                    case[key] = value
+                    cases.append(case)
+    for case in cases:
+        args = (case['fftSize'], case['fftSize']*case['overlap']/100, case['numAvg'],
+                case['logCoeff'], case['cxData'], case['streams'])
+        def test(self, args=args):
+            self.runCase(*args)
+        name = 'testBenchmark_'+BenchmarkTests.caseName(*args)
+        test.__name__ = name
+        setattr(BenchmarkTests, name, test)
+
+_addBenchmarkCases()
+
 if __name__ == "__main__":
     ossie.utils.testing.main("../psd.spd.xml") # By default tests all implementations